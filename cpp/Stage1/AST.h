@@ -1,123 +1,260 @@
 #ifndef AST_H
 #define AST_H
 
+#include <cstdint>
 #include <vector>
 #include <string>
-#include <memory>
+#include "Interner.h"
 
 /**
  * Abstract Syntax Tree (AST) nodes.
  * The AST represents the structure of the program.
+ *
+ * Memory layout:
+ * Every node of a program is stored in a single array owned by the
+ * ProgramNode (the program's arena), in the order the parser created
+ * them. Nodes refer to their children by 32-bit index into that array
+ * instead of by pointer. Building a program therefore costs a handful of
+ * allocations instead of one per node, children sit next to their parents
+ * in memory, and the whole tree is released in one step.
  */
 
-// Forward declarations
-class Statement;
-class Expression;
-
 /**
- * Root node representing an entire program.
+ * Index of a node in ProgramNode::nodes.
  */
-class ProgramNode {
-public:
-    std::vector<std::unique_ptr<Statement>> statements;
-
-    ProgramNode(std::vector<std::unique_ptr<Statement>> stmts)
-        : statements(std::move(stmts)) {}
-};
+using NodeIndex = uint32_t;
 
 /**
- * Base class for all statements.
+ * Marks a child that is not present.
  */
-class Statement {
-public:
-    virtual ~Statement() = default;
-};
+const NodeIndex NO_NODE = UINT32_MAX;
 
 /**
- * Variable declaration statement: var identifier = expression;
+ * NodeKind - What a node represents.
  */
-class VarDeclarationStatement : public Statement {
-public:
-    std::string variableName;
-    std::unique_ptr<Expression> expression;
+enum class NodeKind : uint8_t {
+    // Statements
+    VAR_DECLARATION,    // var identifier = expression;
+    ASSIGNMENT,         // identifier = expression;
+    PRINT,              // print(expression);
 
-    VarDeclarationStatement(const std::string& name, std::unique_ptr<Expression> expr)
-        : variableName(name), expression(std::move(expr)) {}
+    // Expressions
+    INTEGER_LITERAL,    // 42, 10
+    VARIABLE_REFERENCE, // x, count
+    BINARY_EXPRESSION,  // left operator right
+    INPUT_INT           // inputInt()
 };
 
 /**
- * Assignment statement: identifier = expression;
+ * BinaryOp - Operator of a binary expression, decided once by the parser.
+ * Each value is the operator's own character, so it still prints as
+ * written (see symbolOf) and fits in a byte.
  */
-class AssignmentStatement : public Statement {
-public:
-    std::string variableName;
-    std::unique_ptr<Expression> expression;
-
-    AssignmentStatement(const std::string& name, std::unique_ptr<Expression> expr)
-        : variableName(name), expression(std::move(expr)) {}
+enum class BinaryOp : char {
+    ADD = '+',
+    SUBTRACT = '-',
+    MULTIPLY = '*',
+    DIVIDE = '/'
 };
 
 /**
- * Print statement: print(expression);
+ * The operator as it appears in source code, for dumps and messages.
  */
-class PrintStatement : public Statement {
-public:
-    std::unique_ptr<Expression> expression;
-
-    PrintStatement(std::unique_ptr<Expression> expr)
-        : expression(std::move(expr)) {}
-};
+inline char symbolOf(BinaryOp op) {
+    return static_cast<char>(op);
+}
 
 /**
- * Base class for all expressions.
+ * Node - One statement or expression.
+ *
+ * Which fields are used depends on the kind:
+ *
+ *   kind                 op    flags   value   slot   left         right   name
+ *   VAR_DECLARATION      -     -       -       yes    expression   -       yes
+ *   ASSIGNMENT           -     -       -       yes    expression   -       yes
+ *   PRINT                -     -       -       -      expression   -       -
+ *   INTEGER_LITERAL      -     -       yes     -      -            -       -
+ *   VARIABLE_REFERENCE   -     -       -       yes    -            -       yes
+ *   BINARY_EXPRESSION    yes   yes     -       -      left         right   -
+ *   INPUT_INT            -     -       -       -      -            -       -
+ *
+ * "name" is a symbol of ProgramNode::symbols; "slot" is filled in by the
+ * Resolver. "flags" holds facts RangeAnalysis proved about the node,
+ * which let the engines leave out runtime checks.
  */
-class Expression {
-public:
-    virtual ~Expression() = default;
-};
+struct Node {
+    // Flags: a division whose divisor is never zero in any run
+    static const uint8_t DIVISOR_NONZERO = 1 << 0;
 
-/**
- * Integer literal: 42, -10
- */
-class IntegerLiteral : public Expression {
-public:
-    int value;
+    NodeKind kind;
+    BinaryOp op;        // Operator of a binary expression
+    uint8_t flags;      // Proven facts (see RangeAnalysis), 0 until analyzed
+    int32_t value;      // Literal value
+    int32_t slot;       // Variable slot, -1 until resolved
+    NodeIndex left;     // Left operand, or the statement's expression
+    NodeIndex right;    // Right operand
+    uint32_t name;      // Variable name, as a symbol
+
+    static Node statement(NodeKind kind, NodeIndex expression, uint32_t name = 0) {
+        return Node{kind, BinaryOp{}, 0, 0, -1, expression, NO_NODE, name};
+    }
+
+    static Node integerLiteral(int32_t value) {
+        return Node{NodeKind::INTEGER_LITERAL, BinaryOp{}, 0, value, -1, NO_NODE, NO_NODE, 0};
+    }
+
+    static Node variableReference(uint32_t name) {
+        return Node{NodeKind::VARIABLE_REFERENCE, BinaryOp{}, 0, 0, -1, NO_NODE, NO_NODE, name};
+    }
+
+    static Node binaryExpression(NodeIndex left, BinaryOp op, NodeIndex right) {
+        return Node{NodeKind::BINARY_EXPRESSION, op, 0, 0, -1, left, right, 0};
+    }
 
-    IntegerLiteral(int v) : value(v) {}
+    static Node inputInt() {
+        return Node{NodeKind::INPUT_INT, BinaryOp{}, 0, 0, -1, NO_NODE, NO_NODE, 0};
+    }
 };
 
 /**
- * Variable reference: x, count
+ * SourceLocation - Line and column (both 1-based) where a node's text
+ * starts. For a binary expression this is its operator.
  */
-class VariableReference : public Expression {
-public:
-    std::string name;
-
-    VariableReference(const std::string& n) : name(n) {}
+struct SourceLocation {
+    uint32_t line;
+    uint32_t column;
 };
 
 /**
- * Binary expression: left operator right
- * Examples: a + b, x * 5, (10 + 5) / 2
+ * Root node representing an entire program.
  */
-class BinaryExpression : public Expression {
+class ProgramNode {
 public:
-    std::unique_ptr<Expression> left;
-    std::string op;  // "+", "-", "*", "/"
-    std::unique_ptr<Expression> right;
+    std::vector<Node> nodes;               // Arena: every node, in parse order
+    std::vector<SourceLocation> locations; // Parallel to nodes: where each node came from
+    std::vector<NodeIndex> statements;     // Top-level statements, in program order
+    Interner symbols;                      // Variable names referenced by Node::name
+    std::vector<std::string> slotNames;    // Filled by the Resolver: slot index -> variable name
 
-    BinaryExpression(std::unique_ptr<Expression> l, const std::string& o, std::unique_ptr<Expression> r)
-        : left(std::move(l)), op(o), right(std::move(r)) {}
+    /**
+     * Appends a node to the arena and returns its index.
+     * Locations are kept apart from the nodes, which the engines walk,
+     * since only error reports and the profiler read them.
+     */
+    NodeIndex add(const Node& node, SourceLocation location = SourceLocation{0, 0}) {
+        nodes.push_back(node);
+        locations.push_back(location);
+        return static_cast<NodeIndex>(nodes.size() - 1);
+    }
+
+    /**
+     * Drops every node and statement but keeps the symbols and the
+     * resolved variable slots, which grow only with the number of
+     * distinct names. Streaming execution calls this after each statement
+     * so memory does not grow with program length.
+     */
+    void clearStatements() {
+        nodes.clear();
+        locations.clear();
+        statements.clear();
+    }
+
+    Node& operator[](NodeIndex index) { return nodes[index]; }
+    const Node& operator[](NodeIndex index) const { return nodes[index]; }
 };
 
 /**
- * Input expression: inputInt()
- * Reads an integer from the console.
+ * TreeWalker - Visits the nodes of a tree without recursion.
+ *
+ * Generated programs can nest expressions tens of thousands of levels
+ * deep, far deeper than the C++ call stack allows one call per level.
+ * The walker keeps the path from the root on the heap instead, so every
+ * pass that uses it handles trees of any depth. A walker can be reused;
+ * its stacks keep their capacity between walks.
  */
-class InputIntExpression : public Expression {
+class TreeWalker {
+private:
+    std::vector<NodeIndex> path;     // Ancestors of the current node, root first
+    std::vector<NodeIndex> results;  // Scratch space for copy()
+
 public:
-    InputIntExpression() {}
+    /**
+     * Calls visit(index) for every node of the tree at root, children
+     * before their parent and left before right: the order in which the
+     * engines evaluate them. visit may change the fields of the node it
+     * is given, but not its children.
+     */
+    template <typename Visit>
+    void postOrder(const Node* nodes, NodeIndex root, Visit&& visit) {
+        path.clear();
+        NodeIndex current = root;
+        NodeIndex last = NO_NODE;
+        while (current != NO_NODE || !path.empty()) {
+            if (current != NO_NODE) {
+                path.push_back(current);
+                current = nodes[current].left;
+                continue;
+            }
+            NodeIndex top = path.back();
+            NodeIndex right = nodes[top].right;
+            if (right != NO_NODE && right != last) {
+                current = right;
+            } else {
+                visit(top);
+                last = top;
+                path.pop_back();
+            }
+        }
+    }
+
+    /**
+     * Depth of the node being visited (1 for the root). Only meaningful
+     * inside postOrder's visit.
+     */
+    size_t depth() const { return path.size(); }
+
+    /**
+     * Number of levels of the tree at root: the depth of its deepest node.
+     */
+    size_t height(const Node* nodes, NodeIndex root) {
+        size_t deepest = 0;
+        postOrder(nodes, root, [&](NodeIndex) { deepest = deepest > path.size() ? deepest : path.size(); });
+        return deepest;
+    }
+
+    /**
+     * Number of levels of the program's deepest statement.
+     */
+    size_t height(const ProgramNode& program) {
+        size_t deepest = 0;
+        for (NodeIndex statement : program.statements) {
+            size_t levels = height(program.nodes.data(), statement);
+            deepest = deepest > levels ? deepest : levels;
+        }
+        return deepest;
+    }
+
+    /**
+     * Copies the tree at root from one program to the end of another's
+     * arena, with its locations, and returns its new index. Symbols are
+     * kept as they are, so both programs must share the same symbols.
+     */
+    NodeIndex copy(const ProgramNode& from, ProgramNode& to, NodeIndex root) {
+        results.clear();
+        postOrder(from.nodes.data(), root, [&](NodeIndex index) {
+            Node node = from[index];
+            if (node.right != NO_NODE) {
+                node.right = results.back();
+                results.pop_back();
+            }
+            if (node.left != NO_NODE) {
+                node.left = results.back();
+                results.pop_back();
+            }
+            results.push_back(to.add(node, from.locations[index]));
+        });
+        return results.back();
+    }
 };
 
 #endif // AST_H
-
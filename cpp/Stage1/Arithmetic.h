@@ -0,0 +1,31 @@
+#ifndef ARITHMETIC_H
+#define ARITHMETIC_H
+
+#include <cstdint>
+
+/**
+ * Arithmetic - MidLang's +, - and * on 32-bit ints.
+ *
+ * Results too big for an int wrap around (modulo 2^32), as they do on
+ * the hardware. Signed overflow is undefined behaviour in C++, so the
+ * operands are widened to unsigned, where wrapping is defined, and the
+ * result is converted back.
+ *
+ * Every engine computes with these, and so does every pass that works
+ * out values ahead of time (Optimizer, Specializer), so they all agree
+ * with each other and with what RangeAnalysis assumes. The JIT gets the
+ * same results from the processor's own add, sub and imul.
+ */
+inline int32_t wrapAdd(int32_t a, int32_t b) {
+    return static_cast<int32_t>(static_cast<uint32_t>(a) + static_cast<uint32_t>(b));
+}
+
+inline int32_t wrapSub(int32_t a, int32_t b) {
+    return static_cast<int32_t>(static_cast<uint32_t>(a) - static_cast<uint32_t>(b));
+}
+
+inline int32_t wrapMul(int32_t a, int32_t b) {
+    return static_cast<int32_t>(static_cast<uint32_t>(a) * static_cast<uint32_t>(b));
+}
+
+#endif // ARITHMETIC_H
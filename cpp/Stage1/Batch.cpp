@@ -0,0 +1,252 @@
+#include "Batch.h"
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include "IO.h"
+
+// Text recorded for a cell missing from its row. Valid cells record a
+// null string_view, so any non-null text marks a bad cell.
+static const char* const MISSING_CELL = "";
+
+BatchEvaluator::BatchEvaluator(const ProgramNode& program, const SimdKernels& kernels)
+    : program(program), kernels(kernels), inputColumnOf(program.nodes.size(), -1), inputCount(0) {
+    for (uint32_t s = 0; s < program.statements.size(); s++) {
+        const Node& statement = program[program.statements[s]];
+        numberInputs(statement.left);
+        if (statement.kind == NodeKind::PRINT) {
+            printStatements.push_back(s);
+        }
+    }
+
+    slotValues.resize(program.slotNames.size() * BLOCK_ROWS);
+    inputValues.resize(inputCount * BLOCK_ROWS);
+    printValues.resize(printStatements.size() * BLOCK_ROWS);
+    divisionFailed.resize(BLOCK_ROWS);
+    failures.resize(BLOCK_ROWS);
+    badCells.resize(inputCount * BLOCK_ROWS);
+    badCellCount.resize(inputCount);
+}
+
+void BatchEvaluator::numberInputs(NodeIndex root) {
+    // Same order as the engines: left operand first
+    walker.postOrder(program.nodes.data(), root, [&](NodeIndex index) {
+        if (program[index].kind == NodeKind::INPUT_INT) {
+            inputColumnOf[index] = static_cast<int32_t>(inputCount++);
+        }
+    });
+}
+
+BatchEvaluator::Summary BatchEvaluator::run(std::string_view input, std::ostream& out) {
+    Summary summary{0, 0};
+    std::string text;
+    writeHeader(text);
+
+    size_t position = 0;
+    for (;;) {
+        size_t rows = readBlock(input, position);
+        if (rows == 0) {
+            break;
+        }
+        for (size_t row = 0; row < rows; row++) {
+            failures[row] = Failure{NO_FAILURE, NO_NODE, nullptr, std::string_view()};
+        }
+
+        size_t print = 0;
+        for (uint32_t s = 0; s < program.statements.size(); s++) {
+            const Node& statement = program[program.statements[s]];
+            const int32_t* value = evaluate(statement.left, s, rows);
+            int32_t* target = (statement.kind == NodeKind::PRINT)
+                                  ? &printValues[print++ * BLOCK_ROWS]
+                                  : &slotValues[static_cast<size_t>(statement.slot) * BLOCK_ROWS];
+            if (value != target) {
+                std::memcpy(target, value, rows * sizeof(int32_t));
+            }
+        }
+
+        writeBlock(text, rows);
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+        text.clear();
+
+        summary.rows += rows;
+        for (size_t row = 0; row < rows; row++) {
+            if (failures[row].statement != NO_FAILURE) {
+                summary.failedRows++;
+            }
+        }
+    }
+
+    out.write(text.data(), static_cast<std::streamsize>(text.size()));
+    out.flush();
+    return summary;
+}
+
+size_t BatchEvaluator::readBlock(std::string_view input, size_t& position) {
+    std::fill(badCellCount.begin(), badCellCount.end(), 0);
+
+    size_t rows = 0;
+    while (rows < BLOCK_ROWS && position < input.size()) {
+        const char* line = input.data() + position;
+        const char* end = static_cast<const char*>(std::memchr(line, '\n', input.size() - position));
+        const char* lineEnd = (end != nullptr) ? end : input.data() + input.size();
+        position = static_cast<size_t>(lineEnd - input.data()) + (end != nullptr ? 1 : 0);
+        if (lineEnd > line && lineEnd[-1] == '\r') {
+            lineEnd--;
+        }
+
+        // Split the line on commas, one cell per input column
+        const char* cell = line;
+        for (size_t column = 0; column < inputCount; column++) {
+            size_t at = column * BLOCK_ROWS + rows;
+            if (cell == nullptr) {
+                inputValues[at] = 0;
+                badCells[at] = std::string_view(MISSING_CELL);
+                badCellCount[column]++;
+                continue;
+            }
+            const char* comma = static_cast<const char*>(std::memchr(cell, ',', static_cast<size_t>(lineEnd - cell)));
+            const char* cellEnd = (comma != nullptr) ? comma : lineEnd;
+
+            int value;
+            if (parseInteger(cell, cellEnd, value)) {
+                inputValues[at] = value;
+                badCells[at] = std::string_view();
+            } else {
+                inputValues[at] = 0;
+                badCells[at] = std::string_view(cell, static_cast<size_t>(cellEnd - cell));
+                badCellCount[column]++;
+            }
+            cell = (comma != nullptr) ? comma + 1 : nullptr;
+        }
+        rows++;
+    }
+    return rows;
+}
+
+const int32_t* BatchEvaluator::evaluate(NodeIndex root, uint32_t statement, size_t rows) {
+    // Operands wait on a stack, children before parents. A value computed
+    // at stack position k is written to registers[k]: an operator's
+    // result may overwrite its left operand but never its right one.
+    operands.clear();
+    walker.postOrder(program.nodes.data(), root, [&](NodeIndex index) {
+        const Node& node = program[index];
+        switch (node.kind) {
+            case NodeKind::INTEGER_LITERAL: {
+                size_t position = operands.size();
+                if (registers.size() <= position) {
+                    registers.resize(position + 1, std::vector<int32_t>(BLOCK_ROWS));
+                }
+                int32_t* out = registers[position].data();
+                std::fill(out, out + rows, node.value);
+                operands.push_back(out);
+                break;
+            }
+            case NodeKind::VARIABLE_REFERENCE:
+                operands.push_back(&slotValues[static_cast<size_t>(node.slot) * BLOCK_ROWS]);
+                break;
+            case NodeKind::INPUT_INT: {
+                size_t column = static_cast<size_t>(inputColumnOf[index]);
+                if (badCellCount[column] > 0) {
+                    for (size_t row = 0; row < rows; row++) {
+                        std::string_view cell = badCells[column * BLOCK_ROWS + row];
+                        if (cell.data() != nullptr) {
+                            fail(row, statement, index, "Invalid integer input: ", cell);
+                        }
+                    }
+                }
+                operands.push_back(&inputValues[column * BLOCK_ROWS]);
+                break;
+            }
+            case NodeKind::BINARY_EXPRESSION: {
+                const int32_t* right = operands.back();
+                operands.pop_back();
+                const int32_t* left = operands.back();
+                operands.pop_back();
+                size_t position = operands.size();
+                if (registers.size() <= position) {
+                    registers.resize(position + 1, std::vector<int32_t>(BLOCK_ROWS));
+                }
+                int32_t* out = registers[position].data();
+                switch (node.op) {
+                    case BinaryOp::ADD:
+                        kernels.add(left, right, out, rows);
+                        break;
+                    case BinaryOp::SUBTRACT:
+                        kernels.subtract(left, right, out, rows);
+                        break;
+                    case BinaryOp::MULTIPLY:
+                        kernels.multiply(left, right, out, rows);
+                        break;
+                    case BinaryOp::DIVIDE: {
+                        // out may share a register with left, but never with
+                        // right, so right still tells the two failures apart
+                        uint8_t* failed = divisionFailed.data();
+                        if (kernels.divide(left, right, out, failed, rows)) {
+                            for (size_t row = 0; row < rows; row++) {
+                                if (failed[row]) {
+                                    failed[row] = 0;
+                                    fail(row, statement, index,
+                                         right[row] == 0 ? "Division by zero" : "Integer overflow in division",
+                                         std::string_view());
+                                }
+                            }
+                        }
+                        break;
+                    }
+                    default:
+                        throw std::runtime_error(std::string("Unknown operator: ") + symbolOf(node.op));
+                }
+                operands.push_back(out);
+                break;
+            }
+            default:
+                throw std::runtime_error("Unknown expression type");
+        }
+    });
+    return operands.back();
+}
+
+void BatchEvaluator::fail(size_t row, uint32_t statement, NodeIndex node, const char* reason, std::string_view cell) {
+    // Only the first failure counts: that is where a normal run stops
+    if (failures[row].statement == NO_FAILURE) {
+        failures[row] = Failure{statement, node, reason, cell};
+    }
+}
+
+void BatchEvaluator::writeHeader(std::string& out) const {
+    for (uint32_t s : printStatements) {
+        const SourceLocation& location = program.locations[program.statements[s]];
+        out += "print@" + std::to_string(location.line) + ":" + std::to_string(location.column) + ",";
+    }
+    out += "error\n";
+}
+
+void BatchEvaluator::writeBlock(std::string& out, size_t rows) const {
+    char number[16];
+    for (size_t row = 0; row < rows; row++) {
+        const Failure& failure = failures[row];
+        for (size_t p = 0; p < printStatements.size(); p++) {
+            // A print ran only if the row had not failed by then
+            if (failure.statement == NO_FAILURE || failure.statement > printStatements[p]) {
+                char* end = std::to_chars(number, number + sizeof(number), printValues[p * BLOCK_ROWS + row]).ptr;
+                out.append(number, end);
+            }
+            out += ',';
+        }
+        if (failure.statement != NO_FAILURE) {
+            // Quoted, since the message contains a comma
+            const SourceLocation& location = program.locations[failure.node];
+            out += '"';
+            out += failure.reason;
+            for (char c : failure.cell) {
+                if (c == '"') out += '"';
+                out += c;
+            }
+            out += " at line ";
+            out.append(number, std::to_chars(number, number + sizeof(number), location.line).ptr);
+            out += ", column ";
+            out.append(number, std::to_chars(number, number + sizeof(number), location.column).ptr);
+            out += '"';
+        }
+        out += '\n';
+    }
+}
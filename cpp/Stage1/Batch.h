@@ -0,0 +1,100 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "AST.h"
+#include "SimdKernels.h"
+
+/**
+ * BatchEvaluator - Runs one program over many independent input rows.
+ *
+ * Purpose: When the same program has to be run for millions of input
+ * tuples, evaluate it column by column instead of once per tuple.
+ *
+ * Input is CSV text, one row per line and one column per inputInt()
+ * call: the first call of a run reads column 1, the next call column 2,
+ * and so on, in the order the program makes them. Cells are parsed like
+ * inputInt() input; extra cells are ignored.
+ *
+ * Output is CSV too: a header line naming each print statement by its
+ * location ("print@4:1"), then one line per input row with one column
+ * per print statement and a final "error" column.
+ *
+ * How it works:
+ * 1. Rows are read in blocks of BLOCK_ROWS and stored as columns
+ * 2. Every statement is evaluated for the whole block at once: each
+ *    operator runs as one SIMD kernel over the block (see SimdKernels.h),
+ *    and each variable is a column of the block
+ * 3. A row that fails (division by zero, invalid input) is marked at
+ *    the statement where it failed, exactly where a normal run would
+ *    have stopped: its earlier prints are kept, its later ones are left
+ *    empty, and the error column says why. Other rows are not affected.
+ *
+ * The program must have been through the Resolver (and may have been
+ * through the Optimizer).
+ */
+class BatchEvaluator {
+public:
+    static const size_t BLOCK_ROWS = 1024;
+
+    struct Summary {
+        size_t rows;
+        size_t failedRows;
+    };
+
+private:
+    const ProgramNode& program;
+    const SimdKernels& kernels;
+
+    std::vector<int32_t> inputColumnOf;    // node -> input column, or -1
+    std::vector<uint32_t> printStatements; // Indexes (into program.statements) of the prints
+    size_t inputCount;
+
+    // Per block: one column of BLOCK_ROWS values for each...
+    std::vector<int32_t> slotValues;       // ...variable slot
+    std::vector<int32_t> inputValues;      // ...input column
+    std::vector<int32_t> printValues;      // ...print statement
+    std::vector<std::vector<int32_t>> registers;  // ...intermediate value, by operand stack position
+    std::vector<uint8_t> divisionFailed;
+
+    // Per row of the block: where it failed, if it did
+    struct Failure {
+        uint32_t statement;     // Index into program.statements, or NO_FAILURE
+        NodeIndex node;         // The division or inputInt() that failed
+        const char* reason;     // Error message, without the location
+        std::string_view cell;  // The bad input text (inputInt() failures)
+    };
+    static const uint32_t NO_FAILURE = UINT32_MAX;
+    std::vector<Failure> failures;
+    std::vector<std::string_view> badCells;     // input column * BLOCK_ROWS + row
+    std::vector<uint32_t> badCellCount;         // per input column
+
+    TreeWalker walker;
+    std::vector<const int32_t*> operands;       // Columns of the operands evaluated so far
+
+    void numberInputs(NodeIndex index);
+    size_t readBlock(std::string_view input, size_t& position);
+    const int32_t* evaluate(NodeIndex index, uint32_t statement, size_t rows);
+    void fail(size_t row, uint32_t statement, NodeIndex node, const char* reason, std::string_view cell);
+    void writeHeader(std::string& out) const;
+    void writeBlock(std::string& out, size_t rows) const;
+
+public:
+    BatchEvaluator(const ProgramNode& program, const SimdKernels& kernels = selectKernels());
+
+    /**
+     * Number of input columns the program reads (its inputInt() calls).
+     */
+    size_t inputColumns() const { return inputCount; }
+
+    /**
+     * Evaluates every row of input and writes the output CSV to out.
+     */
+    Summary run(std::string_view input, std::ostream& out);
+};
+
+#endif // BATCH_H
@@ -0,0 +1,50 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * OpCode - Instructions understood by the stack VM.
+ *
+ * The VM keeps an operand stack of ints. Each instruction pops its
+ * inputs from the stack and pushes its result back.
+ */
+enum class OpCode : uint8_t {
+    PUSH_CONST,     // push operand
+    LOAD_SLOT,      // push slots[operand]
+    STORE_SLOT,     // slots[operand] = pop
+    ADD,            // push (pop a, pop b) -> a + b
+    SUB,            // a - b
+    MUL,            // a * b
+    DIV,            // a / b (runtime error if b == 0)
+    PRINT,          // print pop
+    INPUT_INT,      // push an integer read from the input
+    HALT            // end of program
+};
+
+/**
+ * Instruction - One bytecode instruction: an opcode plus a 32-bit operand.
+ *
+ * The operand is a constant for PUSH_CONST, a slot index for LOAD_SLOT
+ * and STORE_SLOT, and unused otherwise.
+ */
+struct Instruction {
+    OpCode op;
+    int32_t operand;
+};
+
+/**
+ * BytecodeProgram - A program lowered to a flat list of instructions.
+ *
+ * Produced by the Compiler and executed by the VM. Variables live in
+ * the numbered slots assigned by the Resolver.
+ */
+struct BytecodeProgram {
+    std::vector<Instruction> code;
+    size_t slotCount = 0;        // number of variable slots
+    size_t maxStackDepth = 0;    // deepest operand stack the code needs
+};
+
+#endif // BYTECODE_H
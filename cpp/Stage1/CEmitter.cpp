@@ -0,0 +1,294 @@
+#include "CEmitter.h"
+#include <climits>
+#include <cstdlib>
+#include <stdexcept>
+
+// Statements per generated function
+static const size_t STATEMENTS_PER_FUNCTION = 2048;
+
+// Copied at the top of every generated file. It mirrors OutputSink,
+// InputSource and the error handling in main.cpp. The helpers are
+// inline so the ones a program never calls raise no warnings.
+static const char* const RUNTIME = R"(#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <io.h>
+#define ml_read _read
+#define ml_isatty _isatty
+#else
+#include <unistd.h>
+#define ml_read read
+#define ml_isatty isatty
+#endif
+
+/* Output: values are formatted into a buffer and written in big blocks */
+static char ml_out[65536];
+static size_t ml_used;
+static int ml_line_buffered;
+
+static inline void ml_flush(void) {
+    fwrite(ml_out, 1, ml_used, stdout);
+    fflush(stdout);
+    ml_used = 0;
+}
+
+static inline void ml_print(int32_t value) {
+    char digits[12];
+    size_t count = 0;
+    uint32_t magnitude = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+    if (ml_used > sizeof ml_out - 16) ml_flush();
+    do {
+        digits[count++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (value < 0) ml_out[ml_used++] = '-';
+    while (count > 0) ml_out[ml_used++] = digits[--count];
+    ml_out[ml_used++] = '\n';
+    if (ml_line_buffered) ml_flush();
+}
+
+/* Errors: "Error: <message>" after all earlier output, exit code 5 */
+static inline void ml_fail(const char* message, const char* detail, size_t detailLength) {
+    ml_flush();
+    fprintf(stderr, "Error: %s", message);
+    fwrite(detail, 1, detailLength, stderr);
+    fputc('\n', stderr);
+    exit(5);
+}
+
+/* Input: standard input is read in blocks, one integer per line */
+static char* ml_in;
+static size_t ml_in_size, ml_start, ml_end;
+static int ml_end_of_input;
+
+static inline int ml_fill(void) {
+    int count;
+    if (ml_end_of_input) return 0;
+    ml_flush(); /* Show earlier output before waiting for input */
+    if (ml_start > 0) {
+        memmove(ml_in, ml_in + ml_start, ml_end - ml_start);
+        ml_end -= ml_start;
+        ml_start = 0;
+    }
+    if (ml_end == ml_in_size) {
+        ml_in_size = ml_in_size ? ml_in_size * 2 : 65536;
+        ml_in = (char*)realloc(ml_in, ml_in_size);
+        if (ml_in == NULL) ml_fail("Out of memory", "", 0);
+    }
+    count = (int)ml_read(0, ml_in + ml_end, (unsigned)(ml_in_size - ml_end));
+    if (count <= 0) {
+        ml_end_of_input = 1;
+        return 0;
+    }
+    ml_end += (size_t)count;
+    return 1;
+}
+
+/* Accepts exactly what std::stoi accepts */
+static inline int ml_parse(const char* p, const char* last, int32_t* result) {
+    int negative = 0, valid;
+    long long value = 0;
+    while (p < last && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\v' || *p == '\f')) p++;
+    if (p < last && (*p == '+' || *p == '-')) {
+        negative = (*p == '-');
+        p++;
+    }
+    valid = (p < last && *p >= '0' && *p <= '9');
+    while (valid && p < last && *p >= '0' && *p <= '9') {
+        value = value * 10 + (*p++ - '0');
+        if (value > (long long)INT32_MAX + 1) valid = 0;
+    }
+    if (valid && !negative && value > INT32_MAX) valid = 0;
+    if (valid) *result = (int32_t)(negative ? -value : value);
+    return valid;
+}
+
+static inline int32_t ml_input(void) {
+    size_t scanned = 0;
+    const char* newline = NULL;
+    const char* line;
+    const char* lineEnd;
+    int32_t value;
+    for (;;) {
+        if (ml_end > ml_start + scanned) {
+            newline = (const char*)memchr(ml_in + ml_start + scanned, '\n', ml_end - ml_start - scanned);
+            if (newline != NULL) break;
+        }
+        scanned = ml_end - ml_start;
+        if (!ml_fill()) break;
+    }
+    line = ml_in ? ml_in + ml_start : "";
+    lineEnd = newline != NULL ? newline : line + (ml_end - ml_start);
+    ml_start = newline != NULL ? (size_t)(newline + 1 - ml_in) : ml_end;
+    if (!ml_parse(line, lineEnd, &value)) {
+        ml_fail("Invalid integer input: ", line, (size_t)(lineEnd - line));
+    }
+    return value;
+}
+
+/* 32-bit arithmetic that wraps around, like the interpreter */
+static inline int32_t ml_add(int32_t a, int32_t b) { return (int32_t)((uint32_t)a + (uint32_t)b); }
+static inline int32_t ml_sub(int32_t a, int32_t b) { return (int32_t)((uint32_t)a - (uint32_t)b); }
+static inline int32_t ml_mul(int32_t a, int32_t b) { return (int32_t)((uint32_t)a * (uint32_t)b); }
+
+static inline int32_t ml_div(int32_t a, int32_t b) {
+    if (b == 0) ml_fail("Division by zero", "", 0);
+    if (b == -1 && a == INT32_MIN) {
+        /* Undefined in C, so the compiler may not trap here by itself.
+           The interpreter's engines die of SIGFPE, unflushed output lost. */
+        signal(SIGFPE, SIG_DFL);
+        raise(SIGFPE);
+    }
+    return a / b;
+}
+)";
+
+CEmitter::CEmitter() : program(nullptr), out(nullptr), temporaries(0) {}
+
+void CEmitter::emit(const ProgramNode& program, std::ostream& out) {
+    this->program = &program;
+    this->out = &out;
+
+    out << "/* Generated from MidLang source. Behaves like \"interpreter --quiet\". */\n";
+    emitRuntime();
+
+    out << "\n/* Variables */\n";
+    for (size_t slot = 0; slot < program.slotNames.size(); slot++) {
+        out << "static int32_t " << variableName(static_cast<int32_t>(slot)) << ";\n";
+    }
+
+    size_t functions = 0;
+    for (size_t i = 0; i < program.statements.size(); i++) {
+        if (i % STATEMENTS_PER_FUNCTION == 0) {
+            if (i > 0) {
+                out << "}\n";
+            }
+            out << "\nstatic void ml_part" << functions++ << "(void) {\n";
+        }
+        emitStatement(program[program.statements[i]]);
+    }
+    if (functions > 0) {
+        out << "}\n";
+    }
+
+    out << "\nint main(void) {\n";
+    out << "    ml_line_buffered = ml_isatty(1);\n";
+    for (size_t i = 0; i < functions; i++) {
+        out << "    ml_part" << i << "();\n";
+    }
+    out << "    ml_flush();\n";
+    out << "    return 0;\n";
+    out << "}\n";
+
+    this->program = nullptr;
+    this->out = nullptr;
+}
+
+void CEmitter::emitRuntime() {
+    *out << RUNTIME;
+}
+
+void CEmitter::emitStatement(const Node& statement) {
+    NodeIndex index = static_cast<NodeIndex>(&statement - program->nodes.data());
+    SourceLocation location = program->locations[index];
+    *out << "    /* line " << location.line << " */\n";
+    *out << "    {\n";
+
+    temporaries = 0;
+    std::string value = emitExpression(statement.left);
+    switch (statement.kind) {
+        case NodeKind::VAR_DECLARATION:
+        case NodeKind::ASSIGNMENT:
+            *out << "        " << variableName(statement.slot) << " = " << value << ";\n";
+            break;
+        case NodeKind::PRINT:
+            *out << "        ml_print(" << value << ");\n";
+            break;
+        default:
+            throw std::runtime_error("Unknown statement type");
+    }
+    *out << "    }\n";
+}
+
+std::string CEmitter::emitExpression(NodeIndex root) {
+    // Returns a C expression for the value. Everything but a literal or a
+    // variable is stored in a temporary first, so inputInt() calls and
+    // divisions run in the Evaluator's order.
+    values.clear();
+    walker.postOrder(program->nodes.data(), root, [&](NodeIndex index) {
+        const Node& node = (*program)[index];
+        std::string value;
+        switch (node.kind) {
+            case NodeKind::INTEGER_LITERAL:
+                values.push_back(node.value == INT_MIN ? "INT32_MIN" : std::to_string(node.value));
+                return;
+            case NodeKind::VARIABLE_REFERENCE:
+                values.push_back(variableName(node.slot));
+                return;
+            case NodeKind::INPUT_INT:
+                value = "ml_input()";
+                break;
+            case NodeKind::BINARY_EXPRESSION: {
+                const char* function;
+                switch (node.op) {
+                    case BinaryOp::ADD: function = "ml_add"; break;
+                    case BinaryOp::SUBTRACT: function = "ml_sub"; break;
+                    case BinaryOp::MULTIPLY: function = "ml_mul"; break;
+                    case BinaryOp::DIVIDE: function = "ml_div"; break;
+                    default:
+                        throw std::runtime_error(std::string("Unknown operator: ") + symbolOf(node.op));
+                }
+                // The operands' values are on top of the stack, right above left
+                std::string right = std::move(values.back());
+                values.pop_back();
+                value = std::string(function) + "(" + values.back() + ", " + right + ")";
+                values.pop_back();
+                break;
+            }
+            default:
+                throw std::runtime_error("Unknown expression type");
+        }
+
+        std::string temporary = "t" + std::to_string(temporaries++);
+        *out << "        int32_t " << temporary << " = " << value << ";\n";
+        values.push_back(std::move(temporary));
+    });
+    return values.back();
+}
+
+std::string CEmitter::variableName(int32_t slot) const {
+    // Prefixed, so no MidLang name can clash with C keywords or the runtime;
+    // SsaOptimizer temporaries ("$t0") get a prefix of their own
+    const std::string& name = program->slotNames[slot];
+    if (!name.empty() && name[0] == '$') {
+        return "s_" + name.substr(1);
+    }
+    return "v_" + name;
+}
+
+// Quotes an argument for the shell that std::system uses
+static std::string quote(const std::string& argument) {
+#ifdef _WIN32
+    return "\"" + argument + "\"";
+#else
+    std::string quoted = "'";
+    for (char c : argument) {
+        if (c == '\'') {
+            quoted += "'\\''";
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "'";
+#endif
+}
+
+bool CEmitter::buildExecutable(const std::string& cFile, const std::string& executable, std::string& command) {
+    const char* compiler = std::getenv("CC");
+    command = (compiler != nullptr && *compiler != '\0') ? compiler : "cc";
+    command += " -O2 -o " + quote(executable) + " " + quote(cFile);
+    return std::system(command.c_str()) == 0;
+}
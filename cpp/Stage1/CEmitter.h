@@ -0,0 +1,63 @@
+#ifndef CEMITTER_H
+#define CEMITTER_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "AST.h"
+
+/**
+ * CEmitter (AST to C source)
+ *
+ * Purpose: Translates a program into a self-contained C file, so a
+ * script that rarely changes can be compiled once into a standalone
+ * native executable with no interpreter start-up.
+ *
+ * How it works:
+ * 1. Every variable becomes a static int32_t named after it; every
+ *    statement becomes a block of three-address C code, so inputInt()
+ *    calls and divisions happen in exactly the order the Evaluator
+ *    runs them (C leaves the order of operands unspecified)
+ * 2. Arithmetic goes through small helpers that wrap around in 32 bits
+ *    like the interpreter, and division checks for zero
+ * 3. A small runtime is copied into the file: block-buffered output,
+ *    input parsed exactly like InputSource, and errors reported as
+ *    "Error: <message>" on stderr with the interpreter's exit code
+ * 4. Statements are split across functions of a bounded size, so very
+ *    large programs stay quick for the C compiler
+ *
+ * The generated program behaves like "interpreter --quiet".
+ * Undefined variables are reported by the Resolver before anything is
+ * emitted, as with every other engine.
+ */
+class CEmitter {
+private:
+    const ProgramNode* program;
+    std::ostream* out;
+    size_t temporaries;         // Temporaries declared in the current statement
+    TreeWalker walker;
+    std::vector<std::string> values;  // C expressions of the operands emitted so far
+
+    void emitRuntime();
+    void emitStatement(const Node& statement);
+    std::string emitExpression(NodeIndex index);
+    std::string variableName(int32_t slot) const;
+
+public:
+    CEmitter();
+
+    /**
+     * Writes C source for a program that has been through the Resolver.
+     */
+    void emit(const ProgramNode& program, std::ostream& out);
+
+    /**
+     * Compiles a C file with the system C compiler (the CC environment
+     * variable, or "cc") at -O2 into an executable. Returns false, with
+     * the command that failed in command, if the compiler reports an error.
+     */
+    static bool buildExecutable(const std::string& cFile, const std::string& executable,
+                                std::string& command);
+};
+
+#endif // CEMITTER_H
@@ -0,0 +1,210 @@
+#include "ClosureEngine.h"
+#include "Arithmetic.h"
+#include "Errors.h"
+#include <algorithm>
+#include <stdexcept>
+
+// How each kind of operand is fetched
+struct LiteralOperand {
+    static int32_t get(const ClosureOperand& operand, ClosureContext&) { return operand.value; }
+};
+
+struct VariableOperand {
+    static int32_t get(const ClosureOperand& operand, ClosureContext& context) {
+        return context.slots[operand.value];
+    }
+};
+
+struct NestedOperand {
+    static int32_t get(const ClosureOperand& operand, ClosureContext& context) {
+        return operand.closure->function(*operand.closure, context);
+    }
+};
+
+// The operators, with the same 32-bit results as the other engines
+struct Add {
+    static int32_t apply(int32_t a, int32_t b) {
+        return wrapAdd(a, b);
+    }
+};
+
+struct Subtract {
+    static int32_t apply(int32_t a, int32_t b) {
+        return wrapSub(a, b);
+    }
+};
+
+struct Multiply {
+    static int32_t apply(int32_t a, int32_t b) {
+        return wrapMul(a, b);
+    }
+};
+
+struct Divide {
+    static int32_t apply(int32_t a, int32_t b) {
+        if (b == 0) {
+            throw RuntimeError("Division by zero");
+        }
+        return a / b;
+    }
+};
+
+// Division by a literal that is not zero, or by anything else RangeAnalysis
+// proved is never zero, needs no check
+struct DivideUnchecked {
+    static int32_t apply(int32_t a, int32_t b) { return a / b; }
+};
+
+template <class Op, class Left, class Right>
+static int32_t binary(const Closure& self, ClosureContext& context) {
+    int32_t left = Left::get(self.left, context);
+    int32_t right = Right::get(self.right, context);
+    return Op::apply(left, right);
+}
+
+static int32_t inputInt(const Closure&, ClosureContext& context) {
+    return context.input->readInt();
+}
+
+template <class Value>
+struct Store {
+    static void run(const StatementClosure& self, ClosureContext& context) {
+        context.slots[self.slot] = Value::get(self.value, context);
+    }
+};
+
+template <class Value>
+struct Print {
+    static void run(const StatementClosure& self, ClosureContext& context) {
+        context.output->writeInt(Value::get(self.value, context));
+    }
+};
+
+// Picks the template instance for a pair of operand kinds
+using ClosureFunction = int32_t (*)(const Closure&, ClosureContext&);
+
+template <class Op, class Left>
+static ClosureFunction selectRight(OperandKind right) {
+    switch (right) {
+        case OperandKind::LITERAL: return &binary<Op, Left, LiteralOperand>;
+        case OperandKind::VARIABLE: return &binary<Op, Left, VariableOperand>;
+        default: return &binary<Op, Left, NestedOperand>;
+    }
+}
+
+template <class Op>
+static ClosureFunction select(OperandKind left, OperandKind right) {
+    switch (left) {
+        case OperandKind::LITERAL: return selectRight<Op, LiteralOperand>(right);
+        case OperandKind::VARIABLE: return selectRight<Op, VariableOperand>(right);
+        default: return selectRight<Op, NestedOperand>(right);
+    }
+}
+
+using StatementFunction = void (*)(const StatementClosure&, ClosureContext&);
+
+template <template <class> class Statement>
+static StatementFunction selectStatement(OperandKind value) {
+    switch (value) {
+        case OperandKind::LITERAL: return &Statement<LiteralOperand>::run;
+        case OperandKind::VARIABLE: return &Statement<VariableOperand>::run;
+        default: return &Statement<NestedOperand>::run;
+    }
+}
+
+ClosureEngine::ClosureEngine(OutputSink& output, InputSource& input) : output(output), input(input) {}
+
+bool ClosureEngine::canRun(const ProgramNode& program) {
+    TreeWalker walker;
+    return walker.height(program) <= MAX_DEPTH;
+}
+
+void ClosureEngine::compile(const ProgramNode& program) {
+    closures.clear();
+    statements.clear();
+    // One closure per node at most, so the vector never reallocates
+    closures.reserve(program.nodes.size());
+    statements.reserve(program.statements.size());
+    slots.assign(program.slotNames.size(), 0);
+
+    for (NodeIndex index : program.statements) {
+        const Node& node = program[index];
+        StatementClosure statement;
+        OperandKind kind;
+        statement.slot = node.slot;
+        statement.value = operand(program, node.left, kind);
+        switch (node.kind) {
+            case NodeKind::VAR_DECLARATION:
+            case NodeKind::ASSIGNMENT:
+                statement.function = selectStatement<Store>(kind);
+                break;
+            case NodeKind::PRINT:
+                statement.function = selectStatement<Print>(kind);
+                break;
+            default:
+                throw std::runtime_error("Unknown statement type");
+        }
+        statements.push_back(statement);
+    }
+}
+
+ClosureOperand ClosureEngine::operand(const ProgramNode& program, NodeIndex index, OperandKind& kind) {
+    const Node& node = program[index];
+    switch (node.kind) {
+        case NodeKind::INTEGER_LITERAL:
+            kind = OperandKind::LITERAL;
+            return ClosureOperand{node.value, nullptr};
+        case NodeKind::VARIABLE_REFERENCE:
+            kind = OperandKind::VARIABLE;
+            return ClosureOperand{node.slot, nullptr};
+        default:
+            kind = OperandKind::NESTED;
+            return ClosureOperand{0, compileExpression(program, index)};
+    }
+}
+
+const Closure* ClosureEngine::compileExpression(const ProgramNode& program, NodeIndex index) {
+    const Node& node = program[index];
+    Closure closure{nullptr, ClosureOperand{0, nullptr}, ClosureOperand{0, nullptr}};
+
+    switch (node.kind) {
+        case NodeKind::INPUT_INT:
+            closure.function = &inputInt;
+            break;
+        case NodeKind::BINARY_EXPRESSION: {
+            OperandKind left;
+            OperandKind right;
+            closure.left = operand(program, node.left, left);
+            closure.right = operand(program, node.right, right);
+            switch (node.op) {
+                case BinaryOp::ADD: closure.function = select<Add>(left, right); break;
+                case BinaryOp::SUBTRACT: closure.function = select<Subtract>(left, right); break;
+                case BinaryOp::MULTIPLY: closure.function = select<Multiply>(left, right); break;
+                case BinaryOp::DIVIDE:
+                    if ((right == OperandKind::LITERAL && closure.right.value != 0)
+                        || (node.flags & Node::DIVISOR_NONZERO)) {
+                        closure.function = select<DivideUnchecked>(left, right);
+                    } else {
+                        closure.function = select<Divide>(left, right);
+                    }
+                    break;
+                default:
+                    throw std::runtime_error(std::string("Unknown operator: ") + symbolOf(node.op));
+            }
+            break;
+        }
+        default:
+            throw std::runtime_error("Unknown expression type");
+    }
+
+    closures.push_back(closure);
+    return &closures.back();
+}
+
+void ClosureEngine::run() {
+    std::fill(slots.begin(), slots.end(), 0);
+    ClosureContext context{slots.data(), &output, &input};
+    for (const StatementClosure& statement : statements) {
+        statement.function(statement, context);
+    }
+}
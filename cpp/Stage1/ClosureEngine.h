@@ -0,0 +1,113 @@
+#ifndef CLOSURE_ENGINE_H
+#define CLOSURE_ENGINE_H
+
+#include <cstdint>
+#include <vector>
+#include "AST.h"
+#include "IO.h"
+
+/**
+ * State a running closure can reach: the variables and the program's I/O.
+ */
+struct ClosureContext {
+    int32_t* slots;
+    OutputSink* output;
+    InputSource* input;
+};
+
+struct Closure;
+
+/**
+ * The kinds of operand a closure can be specialized for.
+ */
+enum class OperandKind {
+    LITERAL,
+    VARIABLE,
+    NESTED      // A subexpression, computed by another closure
+};
+
+/**
+ * One operand of a closure. What it holds depends on the kind of operand
+ * the closure was specialized for: a literal's value, a variable's slot,
+ * or the closure that computes a subexpression.
+ */
+struct ClosureOperand {
+    int32_t value;
+    const Closure* closure;
+};
+
+/**
+ * Closure - A compiled expression: a function that already knows its
+ * operator and the kind of each operand, plus those operands.
+ */
+struct Closure {
+    int32_t (*function)(const Closure& self, ClosureContext& context);
+    ClosureOperand left;
+    ClosureOperand right;
+};
+
+/**
+ * StatementClosure - A compiled statement: store to a slot, or print.
+ */
+struct StatementClosure {
+    void (*function)(const StatementClosure& self, ClosureContext& context);
+    int32_t slot;
+    ClosureOperand value;
+};
+
+/**
+ * ClosureEngine (Closure compiler)
+ *
+ * Purpose: Runs a program with less overhead than walking the tree,
+ * without going all the way to bytecode or machine code.
+ *
+ * How it works:
+ * 1. compile() turns every node into a Closure once. Each Closure's
+ *    function is a template instance chosen for its operator and for
+ *    the kind of each operand (literal, variable or subexpression), so
+ *    a + 1 reads the variable and adds the constant directly
+ * 2. Statements become StatementClosures that know their target slot
+ * 3. run() just calls the statement closures in order: no switch on
+ *    node kinds or operators is left at run time
+ *
+ * Output and errors are exactly those of the Evaluator.
+ *
+ * A closure calls the closures of its operands, so running (and building)
+ * them takes one call per level of nesting. Programs nested deeper than
+ * MAX_DEPTH would exhaust the call stack; canRun() tells callers to use
+ * the Evaluator for those.
+ */
+class ClosureEngine {
+private:
+    std::vector<Closure> closures;      // Reserved up front, so pointers into it stay valid
+    std::vector<StatementClosure> statements;
+    std::vector<int32_t> slots;
+    OutputSink& output;
+    InputSource& input;
+
+    ClosureOperand operand(const ProgramNode& program, NodeIndex index, OperandKind& kind);
+    const Closure* compileExpression(const ProgramNode& program, NodeIndex index);
+
+public:
+    static const size_t MAX_DEPTH = 10000;
+
+    ClosureEngine(OutputSink& output, InputSource& input);
+
+    /**
+     * Whether no statement of the program is nested more than MAX_DEPTH
+     * levels deep.
+     */
+    static bool canRun(const ProgramNode& program);
+
+    /**
+     * Builds the closures for a program that has been through the Resolver.
+     */
+    void compile(const ProgramNode& program);
+
+    /**
+     * Runs the compiled program from the start, with every variable at zero.
+     */
+    void run();
+};
+
+#endif // CLOSURE_ENGINE_H
@@ -0,0 +1,96 @@
+#include "Compiler.h"
+#include <stdexcept>
+#include <sstream>
+
+Compiler::Compiler() : stackDepth(0), nodes(nullptr) {}
+
+BytecodeProgram Compiler::compile(ProgramNode* ast) {
+    nodes = ast->nodes.data();
+    for (NodeIndex statement : ast->statements) {
+        compileStatement(nodes[statement]);
+    }
+    emit(OpCode::HALT);
+    program.slotCount = ast->slotNames.size();
+
+    BytecodeProgram result = std::move(program);
+    program = BytecodeProgram();
+    stackDepth = 0;
+    nodes = nullptr;
+    return result;
+}
+
+void Compiler::compileStatement(const Node& statement) {
+    compileExpression(statement.left);
+
+    switch (statement.kind) {
+        case NodeKind::VAR_DECLARATION:
+        case NodeKind::ASSIGNMENT:
+            emit(OpCode::STORE_SLOT, statement.slot);
+            break;
+        case NodeKind::PRINT:
+            emit(OpCode::PRINT);
+            break;
+        default:
+            throw std::runtime_error("Unknown statement type");
+    }
+}
+
+void Compiler::compileExpression(NodeIndex expression) {
+    walker.postOrder(nodes, expression, [&](NodeIndex index) { compileNode(nodes[index]); });
+}
+
+void Compiler::compileNode(const Node& expression) {
+    // Operands have already been emitted
+    switch (expression.kind) {
+        case NodeKind::INTEGER_LITERAL:
+            emit(OpCode::PUSH_CONST, expression.value);
+            break;
+        case NodeKind::INPUT_INT:
+            emit(OpCode::INPUT_INT);
+            break;
+        case NodeKind::VARIABLE_REFERENCE:
+            emit(OpCode::LOAD_SLOT, expression.slot);
+            break;
+        case NodeKind::BINARY_EXPRESSION:
+            switch (expression.op) {
+                case BinaryOp::ADD: emit(OpCode::ADD); break;
+                case BinaryOp::SUBTRACT: emit(OpCode::SUB); break;
+                case BinaryOp::MULTIPLY: emit(OpCode::MUL); break;
+                case BinaryOp::DIVIDE: emit(OpCode::DIV); break;
+                default: {
+                    std::stringstream ss;
+                    ss << "Unknown operator: " << symbolOf(expression.op);
+                    throw std::runtime_error(ss.str());
+                }
+            }
+            break;
+        default:
+            throw std::runtime_error("Unknown expression type");
+    }
+}
+
+void Compiler::emit(OpCode op, int32_t operand) {
+    // Track the operand stack height so the VM can size its stack once
+    switch (op) {
+        case OpCode::PUSH_CONST:
+        case OpCode::LOAD_SLOT:
+        case OpCode::INPUT_INT:
+            stackDepth++;
+            break;
+        case OpCode::ADD:
+        case OpCode::SUB:
+        case OpCode::MUL:
+        case OpCode::DIV:
+        case OpCode::STORE_SLOT:
+        case OpCode::PRINT:
+            stackDepth--;
+            break;
+        case OpCode::HALT:
+            break;
+    }
+    if (stackDepth > program.maxStackDepth) {
+        program.maxStackDepth = stackDepth;
+    }
+
+    program.code.push_back(Instruction{op, operand});
+}
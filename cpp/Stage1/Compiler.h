@@ -0,0 +1,43 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include "AST.h"
+#include "Bytecode.h"
+
+/**
+ * Compiler (AST to bytecode)
+ *
+ * Purpose: Lowers the AST into a linear list of stack-machine instructions
+ * so the VM can run the program without walking the tree.
+ *
+ * How it works:
+ * 1. Visits each statement once, in order
+ * 2. Emits expression operands before their operator (post-order),
+ *    which is exactly the order a stack machine needs. A TreeWalker
+ *    provides that order without recursion, for expressions of any depth
+ * 3. Uses the variable slots assigned by the Resolver as operands
+ */
+class Compiler {
+private:
+    BytecodeProgram program;
+    size_t stackDepth;
+    const Node* nodes;  // Node arena of the program being compiled
+    TreeWalker walker;
+
+    // Helper methods
+    void compileStatement(const Node& statement);
+    void compileExpression(NodeIndex expression);
+    void compileNode(const Node& node);
+    void emit(OpCode op, int32_t operand = 0);
+
+public:
+    Compiler();
+
+    /**
+     * Compiles a whole program that has been through the Resolver.
+     * The result ends with a HALT instruction.
+     */
+    BytecodeProgram compile(ProgramNode* program);
+};
+
+#endif // COMPILER_H
@@ -0,0 +1,44 @@
+#ifndef ERRORS_H
+#define ERRORS_H
+
+#include <stdexcept>
+#include <string>
+
+/**
+ * Error classes for each stage that can reject a program.
+ *
+ * Purpose: Let the caller tell what kind of failure happened (main.cpp
+ * turns each one into its own exit code) without parsing messages.
+ *
+ * All of them derive from std::runtime_error, so code that catches
+ * std::runtime_error or std::exception still sees every error, with the
+ * same messages as before.
+ */
+
+/**
+ * LexError - The source contains a character or literal the lexer cannot read.
+ */
+class LexError : public std::runtime_error {
+public:
+    explicit LexError(const std::string& message) : std::runtime_error(message) {}
+};
+
+/**
+ * ParseError - The tokens do not form a valid program, or a variable is
+ * read before it is assigned (found by the Resolver before anything runs).
+ */
+class ParseError : public std::runtime_error {
+public:
+    explicit ParseError(const std::string& message) : std::runtime_error(message) {}
+};
+
+/**
+ * RuntimeError - The program failed while running: division by zero or
+ * invalid input to inputInt().
+ */
+class RuntimeError : public std::runtime_error {
+public:
+    explicit RuntimeError(const std::string& message) : std::runtime_error(message) {}
+};
+
+#endif // ERRORS_H
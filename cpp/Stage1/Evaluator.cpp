@@ -1,94 +1,207 @@
 #include "Evaluator.h"
-#include <iostream>
+#include "Arithmetic.h"
+#include "Errors.h"
 #include <stdexcept>
+#include <chrono>
 #include <sstream>
 
+using ProfileClock = std::chrono::steady_clock;
+
+static int64_t nanosecondsSince(ProfileClock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(ProfileClock::now() - start).count();
+}
+
+Evaluator::Evaluator(OutputSink& output, InputSource& input)
+    : output(output), input(input) {}
+
 void Evaluator::evaluate(ProgramNode* program) {
-    for (auto& statement : program->statements) {
-        evaluateStatement(statement.get());
+    slots.assign(program->slotNames.size(), 0);
+    nodes = program->nodes.data();
+
+    for (NodeIndex statement : program->statements) {
+        evaluateStatement<false>(nodes[statement]);
+    }
+}
+
+void Evaluator::evaluate(ProgramNode* program, Profile& profile) {
+    slots.assign(program->slotNames.size(), 0);
+    nodes = program->nodes.data();
+    profile.reset(*program);
+    this->profile = &profile;
+
+    for (size_t i = 0; i < program->statements.size(); i++) {
+        currentStatement = &profile.statements[i];
+        currentStatement->count++;
+        auto start = ProfileClock::now();
+        try {
+            evaluateStatement<true>(nodes[program->statements[i]]);
+        } catch (...) {
+            currentStatement->nanoseconds += nanosecondsSince(start);
+            this->profile = nullptr;
+            currentStatement = nullptr;
+            throw;
+        }
+        currentStatement->nanoseconds += nanosecondsSince(start);
+    }
+
+    this->profile = nullptr;
+    currentStatement = nullptr;
+}
+
+void Evaluator::evaluate(ProgramNode* program, NodeIndex statement) {
+    // The statement may have introduced new variables
+    if (slots.size() < program->slotNames.size()) {
+        slots.resize(program->slotNames.size(), 0);
     }
+    nodes = program->nodes.data();
+
+    evaluateStatement<false>(nodes[statement]);
 }
 
-void Evaluator::evaluateStatement(Statement* statement) {
-    if (auto* varDecl = dynamic_cast<VarDeclarationStatement*>(statement)) {
-        evaluateVarDeclaration(varDecl);
-    } else if (auto* assign = dynamic_cast<AssignmentStatement*>(statement)) {
-        evaluateAssignment(assign);
-    } else if (auto* print = dynamic_cast<PrintStatement*>(statement)) {
-        evaluatePrint(print);
-    } else {
-        throw std::runtime_error("Unknown statement type");
+template <bool Profiled>
+void Evaluator::evaluateStatement(const Node& statement) {
+    if (Profiled) {
+        profile->nodeHits[&statement - nodes]++;
+    }
+    switch (statement.kind) {
+        case NodeKind::VAR_DECLARATION:
+            evaluateVarDeclaration<Profiled>(statement);
+            break;
+        case NodeKind::ASSIGNMENT:
+            evaluateAssignment<Profiled>(statement);
+            break;
+        case NodeKind::PRINT:
+            evaluatePrint<Profiled>(statement);
+            break;
+        default:
+            throw std::runtime_error("Unknown statement type");
     }
 }
 
-void Evaluator::evaluateVarDeclaration(VarDeclarationStatement* varDecl) {
-    int value = evaluateExpression(varDecl->expression.get());
-    symbolTable[varDecl->variableName] = value;
+template <bool Profiled>
+void Evaluator::evaluateVarDeclaration(const Node& varDecl) {
+    int value = evaluateExpression<Profiled>(nodes[varDecl.left], 0);
+    slots[varDecl.slot] = value;
 }
 
-void Evaluator::evaluateAssignment(AssignmentStatement* assign) {
-    int value = evaluateExpression(assign->expression.get());
-    symbolTable[assign->variableName] = value;
+template <bool Profiled>
+void Evaluator::evaluateAssignment(const Node& assign) {
+    int value = evaluateExpression<Profiled>(nodes[assign.left], 0);
+    slots[assign.slot] = value;
 }
 
-void Evaluator::evaluatePrint(PrintStatement* print) {
-    int value = evaluateExpression(print->expression.get());
-    std::cout << value << std::endl;
+template <bool Profiled>
+void Evaluator::evaluatePrint(const Node& print) {
+    int value = evaluateExpression<Profiled>(nodes[print.left], 0);
+    output.writeInt(value);
 }
 
-int Evaluator::evaluateExpression(Expression* expression) {
-    if (auto* lit = dynamic_cast<IntegerLiteral*>(expression)) {
-        return lit->value;
-    } else if (auto* input = dynamic_cast<InputIntExpression*>(expression)) {
-        return evaluateInputInt();
-    } else if (auto* varRef = dynamic_cast<VariableReference*>(expression)) {
-        return evaluateVariable(varRef);
-    } else if (auto* binExpr = dynamic_cast<BinaryExpression*>(expression)) {
-        return evaluateBinaryExpression(binExpr);
-    } else {
-        throw std::runtime_error("Unknown expression type");
+template <bool Profiled>
+int Evaluator::evaluateExpression(const Node& expression, size_t depth) {
+    if (Profiled) {
+        profile->nodeHits[&expression - nodes]++;
+    }
+    switch (expression.kind) {
+        case NodeKind::INTEGER_LITERAL:
+            return expression.value;
+        case NodeKind::INPUT_INT:
+            return evaluateInputInt<Profiled>();
+        case NodeKind::VARIABLE_REFERENCE:
+            return evaluateVariable(expression);
+        case NodeKind::BINARY_EXPRESSION:
+            return evaluateBinaryExpression<Profiled>(expression, depth);
+        default:
+            throw std::runtime_error("Unknown expression type");
     }
 }
 
+template <bool Profiled>
+int Evaluator::evaluateDeepExpression(NodeIndex expression) {
+    // The walker reaches the root last, so it is counted like the other
+    // nodes; evaluateExpression already counted it
+    if (Profiled) {
+        profile->nodeHits[expression]--;
+    }
+    values.clear();
+    walker.postOrder(nodes, expression, [&](NodeIndex index) {
+        const Node& node = nodes[index];
+        if (Profiled) {
+            profile->nodeHits[index]++;
+        }
+        switch (node.kind) {
+            case NodeKind::INTEGER_LITERAL:
+                values.push_back(node.value);
+                break;
+            case NodeKind::INPUT_INT:
+                values.push_back(evaluateInputInt<Profiled>());
+                break;
+            case NodeKind::VARIABLE_REFERENCE:
+                values.push_back(evaluateVariable(node));
+                break;
+            case NodeKind::BINARY_EXPRESSION: {
+                // Both operands are on top of the stack, right above left
+                int right = values.back();
+                values.pop_back();
+                values.back() = applyOperator(node, values.back(), right);
+                break;
+            }
+            default:
+                throw std::runtime_error("Unknown expression type");
+        }
+    });
+    return values.back();
+}
+
+template <bool Profiled>
 int Evaluator::evaluateInputInt() {
-    std::string input;
-    std::getline(std::cin, input);
-    try {
-        return std::stoi(input);
-    } catch (const std::exception&) {
-        throw std::runtime_error("Invalid integer input: " + input);
+    if (Profiled) {
+        auto start = ProfileClock::now();
+        int value;
+        try {
+            value = input.readInt();
+        } catch (...) {
+            currentStatement->inputNanoseconds += nanosecondsSince(start);
+            throw;
+        }
+        currentStatement->inputNanoseconds += nanosecondsSince(start);
+        return value;
     }
+    return input.readInt();
 }
 
-int Evaluator::evaluateVariable(VariableReference* varRef) {
-    auto it = symbolTable.find(varRef->name);
-    if (it == symbolTable.end()) {
-        std::stringstream ss;
-        ss << "Undefined variable: " << varRef->name;
-        throw std::runtime_error(ss.str());
+int Evaluator::evaluateVariable(const Node& varRef) {
+    // The Resolver already proved the variable is assigned
+    return slots[varRef.slot];
+}
+
+template <bool Profiled>
+int Evaluator::evaluateBinaryExpression(const Node& binExpr, size_t depth) {
+    if (depth >= RECURSION_LIMIT) {
+        return evaluateDeepExpression<Profiled>(static_cast<NodeIndex>(&binExpr - nodes));
     }
-    return it->second;
+    int left = evaluateExpression<Profiled>(nodes[binExpr.left], depth + 1);
+    int right = evaluateExpression<Profiled>(nodes[binExpr.right], depth + 1);
+    return applyOperator(binExpr, left, right);
 }
 
-int Evaluator::evaluateBinaryExpression(BinaryExpression* binExpr) {
-    int left = evaluateExpression(binExpr->left.get());
-    int right = evaluateExpression(binExpr->right.get());
-
-    if (binExpr->op == "+") {
-        return left + right;
-    } else if (binExpr->op == "-") {
-        return left - right;
-    } else if (binExpr->op == "*") {
-        return left * right;
-    } else if (binExpr->op == "/") {
-        if (right == 0) {
-            throw std::runtime_error("Division by zero");
+int Evaluator::applyOperator(const Node& binExpr, int left, int right) {
+    switch (binExpr.op) {
+        case BinaryOp::ADD:
+            return wrapAdd(left, right);
+        case BinaryOp::SUBTRACT:
+            return wrapSub(left, right);
+        case BinaryOp::MULTIPLY:
+            return wrapMul(left, right);
+        case BinaryOp::DIVIDE:
+            // No check where RangeAnalysis proved the divisor is never zero
+            if (!(binExpr.flags & Node::DIVISOR_NONZERO) && right == 0) {
+                throw RuntimeError("Division by zero");
+            }
+            return left / right;
+        default: {
+            std::stringstream ss;
+            ss << "Unknown operator: " << symbolOf(binExpr.op);
+            throw std::runtime_error(ss.str());
         }
-        return left / right;
-    } else {
-        std::stringstream ss;
-        ss << "Unknown operator: " << binExpr->op;
-        throw std::runtime_error(ss.str());
     }
 }
-
@@ -1,9 +1,10 @@
 #ifndef EVALUATOR_H
 #define EVALUATOR_H
 
-#include <unordered_map>
-#include <string>
+#include <vector>
 #include "AST.h"
+#include "IO.h"
+#include "Profile.h"
 
 /**
  * Evaluator (Interpreter)
@@ -12,31 +13,75 @@
  * 
  * How it works:
  * 1. Traverses the AST nodes
- * 2. Evaluates expressions (computes values)
- * 3. Manages variable storage (symbol table)
+ * 2. Evaluates expressions (computes values). Up to RECURSION_LIMIT
+ *    levels deep this recurses, which is fastest; deeper subtrees are
+ *    evaluated with a TreeWalker and a stack of intermediate values on
+ *    the heap, so expressions may be nested to any depth
+ * 3. Manages variable storage (one value per slot assigned by the Resolver)
  * 4. Executes statements (assignments, prints)
+ *
+ * Profiling: every helper below is a template instantiated twice. The
+ * <false> copies are the normal run; the <true> copies also count each
+ * node and time each statement into a Profile. The choice is made once
+ * per run, so a run without a Profile executes no profiling code at all.
  */
 class Evaluator {
 private:
-    // Symbol table: stores variable names and their values
-    // This is like a dictionary: variable name → value
-    std::unordered_map<std::string, int> symbolTable;
+    // Variable storage: the Resolver numbered every variable,
+    // so this is a plain array indexed by slot → value
+    std::vector<int> slots;
+
+    // Node arena of the program being evaluated
+    const Node* nodes = nullptr;
+
+    // Evaluation state for subtrees deeper than RECURSION_LIMIT
+    static const size_t RECURSION_LIMIT = 256;
+    TreeWalker walker;
+    std::vector<int> values;
+
+    // Where print writes and inputInt() reads
+    OutputSink& output;
+    InputSource& input;
+
+    // Set only during a profiled run
+    Profile* profile = nullptr;
+    StatementProfile* currentStatement = nullptr;
 
     // Helper methods
-    void evaluateStatement(Statement* statement);
-    void evaluateVarDeclaration(VarDeclarationStatement* varDecl);
-    void evaluateAssignment(AssignmentStatement* assign);
-    void evaluatePrint(PrintStatement* print);
-    int evaluateExpression(Expression* expression);
-    int evaluateInputInt();
-    int evaluateVariable(VariableReference* varRef);
-    int evaluateBinaryExpression(BinaryExpression* binExpr);
+    template <bool Profiled> void evaluateStatement(const Node& statement);
+    template <bool Profiled> void evaluateVarDeclaration(const Node& varDecl);
+    template <bool Profiled> void evaluateAssignment(const Node& assign);
+    template <bool Profiled> void evaluatePrint(const Node& print);
+    template <bool Profiled> int evaluateExpression(const Node& expression, size_t depth);
+    template <bool Profiled> int evaluateDeepExpression(NodeIndex expression);
+    template <bool Profiled> int evaluateInputInt();
+    int evaluateVariable(const Node& varRef);
+    template <bool Profiled> int evaluateBinaryExpression(const Node& binExpr, size_t depth);
+    int applyOperator(const Node& binExpr, int left, int right);
 
 public:
+    Evaluator(OutputSink& output, InputSource& input);
+
     /**
      * Evaluates a program by executing all its statements.
+     * The program must have been through the Resolver first.
      */
     void evaluate(ProgramNode* program);
+
+    /**
+     * Evaluates a program like evaluate(program), recording into profile
+     * how often each node ran and how long each statement took. The
+     * profile is reset first and is complete up to the point of failure
+     * if the program throws.
+     */
+    void evaluate(ProgramNode* program, Profile& profile);
+
+    /**
+     * Evaluates one statement of a program, keeping the variables set by
+     * earlier calls. Used for streaming execution, where statements are
+     * run one at a time as soon as they are parsed and resolved.
+     */
+    void evaluate(ProgramNode* program, NodeIndex statement);
 };
 
 #endif // EVALUATOR_H
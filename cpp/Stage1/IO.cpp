@@ -0,0 +1,171 @@
+#include "IO.h"
+#include "Errors.h"
+#include <cerrno>
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <io.h>
+#define MIDLANG_READ _read
+#define MIDLANG_ISATTY _isatty
+#else
+#include <unistd.h>
+#define MIDLANG_READ ::read
+#define MIDLANG_ISATTY isatty
+#endif
+
+static const size_t BLOCK_SIZE = 64 * 1024;
+
+// Longest formatted int ("-2147483648") plus the newline
+static const size_t MAX_INT_CHARS = 12;
+
+OutputSink::OutputSink(std::ostream& stream, bool lineBuffered)
+    : stream(&stream), buffer(BLOCK_SIZE), used(0), lineBuffered(lineBuffered) {}
+
+OutputSink::OutputSink(std::function<void(int)> callback)
+    : stream(nullptr), callback(std::move(callback)), used(0), lineBuffered(false) {}
+
+OutputSink::~OutputSink() {
+    flush();
+}
+
+void OutputSink::writeInt(int value) {
+    if (stream == nullptr) {
+        if (callback) {
+            callback(value);
+        }
+        return;
+    }
+    if (buffer.size() - used < MAX_INT_CHARS) {
+        flush();
+    }
+
+    char* first = buffer.data() + used;
+    char* last = std::to_chars(first, buffer.data() + buffer.size(), value).ptr;
+    *last++ = '\n';
+    used += static_cast<size_t>(last - first);
+
+    if (lineBuffered) {
+        flush();
+    }
+}
+
+void OutputSink::flush() {
+    if (stream == nullptr) {
+        return;
+    }
+    if (used > 0) {
+        stream->write(buffer.data(), static_cast<std::streamsize>(used));
+        used = 0;
+    }
+    stream->flush();
+}
+
+InputSource::InputSource(int fd)
+    : fd(fd), buffer(BLOCK_SIZE), start(0), end(0), endOfInput(false), tied(nullptr) {}
+
+InputSource::InputSource(std::string_view text)
+    : fd(-1), buffer(text.begin(), text.end()), start(0), end(text.size()),
+      endOfInput(true), tied(nullptr) {}
+
+InputSource::InputSource(std::function<int()> callback)
+    : fd(-1), buffer(1), start(0), end(0), endOfInput(true), tied(nullptr), callback(std::move(callback)) {}
+
+bool InputSource::fill() {
+    if (endOfInput) {
+        return false;
+    }
+    if (tied != nullptr) {
+        tied->flush();
+    }
+
+    // Move the unread bytes to the front, and grow if a line fills the block
+    if (start > 0) {
+        std::memmove(buffer.data(), buffer.data() + start, end - start);
+        end -= start;
+        start = 0;
+    }
+    if (end == buffer.size()) {
+        buffer.resize(buffer.size() * 2);
+    }
+
+    for (;;) {
+        auto count = MIDLANG_READ(fd, buffer.data() + end, static_cast<unsigned>(buffer.size() - end));
+        if (count > 0) {
+            end += static_cast<size_t>(count);
+            return true;
+        }
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        endOfInput = true;
+        return false;
+    }
+}
+
+int InputSource::readInt() {
+    if (callback) {
+        return callback();
+    }
+
+    // Find the end of the next line, reading more input as needed
+    size_t scanned = 0;  // Bytes after start known to contain no newline
+    const char* newline = nullptr;
+    for (;;) {
+        // Nothing left to scan: the buffer may not even be allocated (an
+        // empty text), and memchr must not be given a null pointer
+        if (end - start > scanned) {
+            newline = static_cast<const char*>(
+                std::memchr(buffer.data() + start + scanned, '\n', end - start - scanned));
+            if (newline != nullptr) break;
+        }
+        scanned = end - start;
+        if (!fill()) break;
+    }
+
+    const char* line = buffer.data() + start;
+    const char* lineEnd = (newline != nullptr) ? newline : buffer.data() + end;
+    start = (newline != nullptr) ? static_cast<size_t>(newline + 1 - buffer.data()) : end;
+
+    int value;
+    if (!parseInteger(line, lineEnd, value)) {
+        throw RuntimeError("Invalid integer input: " + std::string(line, lineEnd));
+    }
+    return value;
+}
+
+bool parseInteger(const char* first, const char* last, int& result) {
+    // Parse the way std::stoi does
+    const char* p = first;
+    while (p < last && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\v' || *p == '\f')) {
+        p++;
+    }
+    bool negative = false;
+    if (p < last && (*p == '+' || *p == '-')) {
+        negative = (*p == '-');
+        p++;
+    }
+
+    bool valid = (p < last && *p >= '0' && *p <= '9');
+    long long value = 0;
+    while (valid && p < last && *p >= '0' && *p <= '9') {
+        value = value * 10 + (*p++ - '0');
+        if (value > static_cast<long long>(INT_MAX) + 1) {
+            valid = false;
+        }
+    }
+    if (valid && !negative && value > INT_MAX) {
+        valid = false;
+    }
+
+    if (valid) {
+        result = static_cast<int>(negative ? -value : value);
+    }
+    return valid;
+}
+
+bool isInteractive(int fd) {
+    return MIDLANG_ISATTY(fd) != 0;
+}
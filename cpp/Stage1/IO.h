@@ -0,0 +1,122 @@
+#ifndef IO_H
+#define IO_H
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * OutputSink - Where print statements write their values.
+ *
+ * Values are formatted straight into a large buffer with std::to_chars
+ * and handed to the output stream in big blocks: when the buffer fills
+ * up, when flush() is called, and when the sink is destroyed. Writing
+ * each value with std::endl would flush the stream on every print.
+ *
+ * In line-buffered mode (for a person watching a terminal) the buffer is
+ * flushed after every value instead.
+ *
+ * A sink can instead hand each value to a callback, for programs run
+ * inside another application (see MidLang.h).
+ */
+class OutputSink {
+private:
+    std::ostream* stream;                  // nullptr when writing to a callback
+    std::function<void(int)> callback;
+    std::vector<char> buffer;
+    size_t used;
+    bool lineBuffered;
+
+public:
+    OutputSink(std::ostream& stream, bool lineBuffered = false);
+
+    /**
+     * Passes every printed value to callback, unbuffered. An empty
+     * callback discards the output.
+     */
+    explicit OutputSink(std::function<void(int)> callback);
+    ~OutputSink();
+
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+
+    /**
+     * Writes a value followed by a newline.
+     */
+    void writeInt(int value);
+
+    /**
+     * Hands everything buffered so far to the stream and flushes it.
+     */
+    void flush();
+};
+
+/**
+ * InputSource - Where inputInt() reads its values.
+ *
+ * Standard input is read in large blocks, and each line is parsed as an
+ * integer directly from the block, instead of one std::getline and
+ * std::stoi per value. It accepts exactly what std::stoi accepts (leading
+ * whitespace, an optional sign, digits, anything after the digits
+ * ignored), and reports anything else with the same
+ * "Invalid integer input: <line>" error.
+ *
+ * A source can instead ask a callback for each value.
+ */
+class InputSource {
+private:
+    int fd;                     // File descriptor to read from, or -1
+    std::vector<char> buffer;
+    size_t start;               // First unread byte in buffer
+    size_t end;                 // One past the last valid byte in buffer
+    bool endOfInput;
+    OutputSink* tied;           // Flushed before blocking for more input
+    std::function<int()> callback;
+
+    bool fill();
+
+public:
+    InputSource(int fd = 0);
+
+    /**
+     * Reads from a block of text already in memory instead of a file.
+     */
+    explicit InputSource(std::string_view text);
+
+    /**
+     * Calls callback for every value. It may throw to reject the read;
+     * an empty callback behaves like input that has already ended.
+     */
+    explicit InputSource(std::function<int()> callback);
+
+    InputSource(const InputSource&) = delete;
+    InputSource& operator=(const InputSource&) = delete;
+
+    /**
+     * Flushes the given sink whenever more input has to be read, so a
+     * person typing values sees all earlier output first.
+     */
+    void tie(OutputSink* sink) { tied = sink; }
+
+    /**
+     * Reads the next line and parses it as an integer.
+     * Throws RuntimeError if it is not a valid integer.
+     */
+    int readInt();
+};
+
+/**
+ * Parses [first, last) as an integer, accepting exactly what std::stoi
+ * accepts. Returns false (leaving result alone) if it is not one.
+ */
+bool parseInteger(const char* first, const char* last, int& result);
+
+/**
+ * Whether the standard output or input is a terminal.
+ * Used to pick line-buffered output for interactive runs.
+ */
+bool isInteractive(int fd);
+
+#endif // IO_H
@@ -0,0 +1,490 @@
+#include "Incremental.h"
+#include "Errors.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "Resolver.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// Bytes compared at once when looking for the edited range
+static const size_t COMPARE_BLOCK = 4096;
+
+// Link to no element
+static const uint32_t NO_ELEMENT = UINT32_MAX;
+
+// firstAssignments entry of a slot whose first assignment was edited away
+static const uint32_t NOT_ASSIGNED = UINT32_MAX;
+
+template <typename Visit>
+void IncrementalProgram::forEach(uint32_t tree, Visit visit) {
+    // In order, with an explicit stack
+    stack.clear();
+    uint32_t index = tree;
+    while (index != NO_ELEMENT || !stack.empty()) {
+        while (index != NO_ELEMENT) {
+            stack.push_back(index);
+            index = elements[index].left;
+        }
+        index = stack.back();
+        stack.pop_back();
+        uint32_t right = elements[index].right;
+        visit(index);
+        index = right;
+    }
+}
+
+IncrementalProgram::IncrementalProgram()
+    : sourceCurrent(true), root(NO_ELEMENT), seed(2463534242u), deadBytes(0), deadNodes(0), flattened(true),
+      resolved(true) {
+    // An empty source is just the (empty) text after the last statement
+    root = newElement(NO_NODE, 0, Extent{1, 0, 0, 0}, 1, 1);
+}
+
+IncrementalProgram::EditStats IncrementalProgram::update(std::string_view text) {
+    // Only edit() calls since the last update() make the pieces the text
+    if (!sourceCurrent) {
+        source = this->text();
+        sourceCurrent = true;
+    }
+
+    // The changed range: everything between the common prefix and suffix,
+    // compared a block at a time with memcmp before narrowing it down
+    size_t limit = std::min(source.size(), text.size());
+    size_t prefix = 0;
+    while (prefix + COMPARE_BLOCK <= limit && std::memcmp(&source[prefix], &text[prefix], COMPARE_BLOCK) == 0) {
+        prefix += COMPARE_BLOCK;
+    }
+    while (prefix < limit && source[prefix] == text[prefix]) {
+        prefix++;
+    }
+    size_t suffix = 0;
+    while (suffix + COMPARE_BLOCK <= limit - prefix
+           && std::memcmp(&source[source.size() - suffix - COMPARE_BLOCK],
+                          &text[text.size() - suffix - COMPARE_BLOCK], COMPARE_BLOCK) == 0) {
+        suffix += COMPARE_BLOCK;
+    }
+    while (suffix < limit - prefix && source[source.size() - 1 - suffix] == text[text.size() - 1 - suffix]) {
+        suffix++;
+    }
+    EditStats stats;
+    try {
+        stats = edit(prefix, source.size() - prefix - suffix, text.substr(prefix, text.size() - prefix - suffix));
+    } catch (...) {
+        // The edit is kept if only resolving it failed
+        if (!sourceCurrent) {
+            source.assign(text);
+            sourceCurrent = true;
+        }
+        throw;
+    }
+    source.assign(text);
+    sourceCurrent = true;
+    return stats;
+}
+
+IncrementalProgram::EditStats IncrementalProgram::edit(size_t offset, size_t removed, std::string_view inserted) {
+    // Elements [first, next) overlap the edit: from the one it starts in
+    // to the one its last removed byte is in
+    size_t first = elementAt(offset);
+    size_t next = removed > 0 ? std::max(first + 1, elementAt(offset + removed - 1) + 1) : first + 1;
+
+    uint32_t before;
+    uint32_t touched;
+    uint32_t after;
+    split(root, first, before, touched);
+    split(touched, next - first, touched, after);
+
+    // Their text with the edit applied goes at the end of texts, where
+    // the lexer reads it (and any elements it runs on into) in one piece
+    const Extent& head = totalOf(before);
+    uint64_t start = head.bytes;
+    uint32_t line = 1 + head.lineBreaks;
+    uint32_t column = static_cast<uint32_t>(head.lastLine + 1);
+    size_t regionStart = texts.size();
+    texts.reserve(regionStart + totalOf(touched).bytes + inserted.size());
+    forEach(touched, [&](uint32_t element) {
+        texts.append(texts.data() + elements[element].text, elements[element].own.bytes);
+    });
+    texts.replace(regionStart + (offset - start), removed, inserted);
+
+    // A statement parsed from the new text, or the text after the last one
+    struct Parsed {
+        NodeIndex statement;
+        uint64_t text;
+        Extent own;
+        uint32_t line;
+        uint32_t column;
+    };
+    std::vector<Parsed> parsed;
+
+    // Parse statements until they end exactly where an untouched element
+    // begins, or at the end of the source
+    size_t nodeCount = program.nodes.size();
+    Parser parser(tokens);
+    uint64_t position = regionStart;
+    try {
+        for (bool done = false; !done;) {
+            Lexer lexer(texts, position, line, column);
+            for (;;) {
+                if (lexer.offset() == texts.size() && after != NO_ELEMENT) {
+                    done = true;
+                    break;
+                }
+                position = lexer.offset();
+                line = lexer.currentLine();
+                column = lexer.currentColumn();
+                bool found = lexer.tokenizeStatement(tokens);
+                TokenType last = found ? tokens.types[tokens.size() - 2] : TokenType::EOF_TOKEN;
+                if (last != TokenType::SEMICOLON && last != TokenType::UNKNOWN && after != NO_ELEMENT) {
+                    // The statement (or the whitespace) runs on into the
+                    // next element: take that in too and lex it again
+                    uint32_t taken;
+                    split(after, 1, taken, after);
+                    texts.reserve(texts.size() + elements[taken].own.bytes);
+                    texts.append(texts.data() + elements[taken].text, elements[taken].own.bytes);
+                    touched = merge(touched, taken);
+                    break;
+                }
+
+                uint32_t lineBreaks = lexer.currentLine() - line;
+                uint64_t bytes = lexer.offset() - position;
+                Extent own{1, lineBreaks, bytes, lineBreaks > 0 ? lexer.currentColumn() - 1 : bytes};
+                if (!found) {
+                    // Only whitespace is left: the text after the last statement
+                    parsed.push_back(Parsed{NO_NODE, position, own, line, column});
+                    done = true;
+                    break;
+                }
+                NodeIndex statement = parser.parseSingleStatement(program);
+                program.statements.pop_back();
+                parsed.push_back(Parsed{statement, position, own, line, column});
+            }
+        }
+    } catch (...) {
+        program.nodes.resize(nodeCount);
+        program.locations.resize(nodeCount);
+        texts.resize(regionStart);
+        root = merge(merge(before, touched), after);
+        elements[root].parent = NO_ELEMENT;
+        throw;
+    }
+
+    EditStats stats{0, texts.size() - regionStart};
+
+    // Drop the replaced elements
+    std::vector<int32_t> lost;  // Slots whose first assignment is replaced
+    forEach(touched, [&](uint32_t element) {
+        deadBytes += elements[element].own.bytes;
+        freeElements.push_back(element);
+        NodeIndex index = elements[element].statement;
+        if (index == NO_NODE) {
+            return;
+        }
+        walker.postOrder(program.nodes.data(), index, [&](NodeIndex) { deadNodes++; });
+        const Node& statement = program[index];
+        if (resolved && statement.kind != NodeKind::PRINT && firstAssignments[statement.slot] == element) {
+            firstAssignments[statement.slot] = NOT_ASSIGNED;
+            lost.push_back(statement.slot);
+        }
+    });
+
+    // And join the new ones in their place
+    uint32_t replacement = NO_ELEMENT;
+    std::vector<uint32_t> added;
+    for (const Parsed& piece : parsed) {
+        uint32_t element = newElement(piece.statement, piece.text, piece.own, piece.line, piece.column);
+        replacement = merge(replacement, element);
+        if (piece.statement != NO_NODE) {
+            added.push_back(element);
+        }
+    }
+    root = merge(merge(before, replacement), after);
+    elements[root].parent = NO_ELEMENT;
+    stats.statements = added.size();
+    flattened = false;
+    sourceCurrent = false;
+
+    if (deadNodes > program.nodes.size() / 2) {
+        compact();
+    }
+    if (deadBytes > texts.size() / 2) {
+        compactText();
+    }
+
+    // A variable that lost its first assignment and did not get it back
+    // from the new statements may still be assigned further on: only a
+    // full pass can tell
+    bool complete = resolved && resolveStatements(first, added);
+    for (int32_t slot : lost) {
+        complete = complete && firstAssignments[slot] != NOT_ASSIGNED;
+    }
+    if (!complete) {
+        resolveAll();
+    }
+    return stats;
+}
+
+ProgramNode& IncrementalProgram::current() {
+    if (!flattened) {
+        flatten();
+    }
+    return program;
+}
+
+std::string IncrementalProgram::text() {
+    std::string result;
+    result.reserve(totalOf(root).bytes);
+    forEach(root, [&](uint32_t element) {
+        result.append(texts, elements[element].text, elements[element].own.bytes);
+    });
+    return result;
+}
+
+void IncrementalProgram::flatten() {
+    // Every statement in order, and the line and column each starts at
+    program.statements.clear();
+    uint32_t line = 1;
+    uint32_t column = 1;
+    forEach(root, [&](uint32_t index) {
+        Element& element = elements[index];
+        if (element.statement != NO_NODE) {
+            program.statements.push_back(element.statement);
+
+            // Earlier edits added or removed text before it since its
+            // nodes were located
+            if (element.line != line || element.column != column) {
+                walker.postOrder(program.nodes.data(), element.statement, [&](NodeIndex node) {
+                    SourceLocation& location = program.locations[node];
+                    if (location.line == element.line) {
+                        location.column = location.column - element.column + column;
+                    }
+                    location.line = location.line - element.line + line;
+                });
+                element.line = line;
+                element.column = column;
+            }
+        }
+        if (element.own.lineBreaks > 0) {
+            line += element.own.lineBreaks;
+            column = static_cast<uint32_t>(element.own.lastLine + 1);
+        } else {
+            column += static_cast<uint32_t>(element.own.bytes);
+        }
+    });
+    flattened = true;
+}
+
+void IncrementalProgram::resolveAll() {
+    resolved = false;
+    flatten();
+    Resolver resolver;
+    resolver.resolve(&program);
+
+    slots.assign(program.symbols.size(), -1);
+    firstAssignments.assign(program.slotNames.size(), NOT_ASSIGNED);
+    forEach(root, [&](uint32_t element) {
+        if (elements[element].statement == NO_NODE) {
+            return;
+        }
+        const Node& statement = program[elements[element].statement];
+        if (statement.kind != NodeKind::PRINT && firstAssignments[statement.slot] == NOT_ASSIGNED) {
+            slots[statement.name] = statement.slot;
+            firstAssignments[statement.slot] = element;
+        }
+    });
+    resolved = true;
+}
+
+bool IncrementalProgram::resolveStatements(size_t first, const std::vector<uint32_t>& added) {
+    // Like Resolver::resolveStatement, but a read is only valid if the
+    // variable's first assignment comes before the reading statement
+    slots.resize(program.symbols.size(), -1);
+    for (size_t i = 0; i < added.size(); i++) {
+        size_t position = first + i;
+        Node& statement = program[elements[added[i]].statement];
+        if (!resolveExpression(statement.left, position)) {
+            return false;
+        }
+        if (statement.kind == NodeKind::PRINT) {
+            continue;
+        }
+        int32_t& slot = slots[statement.name];
+        if (slot < 0) {
+            slot = static_cast<int32_t>(program.slotNames.size());
+            program.slotNames.push_back(std::string(program.symbols.name(statement.name)));
+            firstAssignments.push_back(added[i]);
+        }
+        statement.slot = slot;
+        uint32_t& assignment = firstAssignments[statement.slot];
+        if (assignment == NOT_ASSIGNED || positionOf(assignment) > position) {
+            assignment = added[i];
+        }
+    }
+    return true;
+}
+
+bool IncrementalProgram::resolveExpression(NodeIndex index, size_t position) {
+    bool resolved = true;
+    walker.postOrder(program.nodes.data(), index, [&](NodeIndex current) {
+        Node& expression = program[current];
+        if (expression.kind != NodeKind::VARIABLE_REFERENCE) {
+            return;
+        }
+        int32_t slot = slots[expression.name];
+        if (slot < 0 || firstAssignments[slot] == NOT_ASSIGNED || positionOf(firstAssignments[slot]) >= position) {
+            resolved = false;
+            return;
+        }
+        expression.slot = slot;
+    });
+    return resolved;
+}
+
+void IncrementalProgram::compact() {
+    ProgramNode live;
+    live.nodes.reserve(program.nodes.size() - deadNodes);
+    live.locations.reserve(program.nodes.size() - deadNodes);
+    forEach(root, [&](uint32_t element) {
+        if (elements[element].statement != NO_NODE) {
+            elements[element].statement = walker.copy(program, live, elements[element].statement);
+        }
+    });
+    live.symbols = std::move(program.symbols);
+    live.slotNames = std::move(program.slotNames);
+    program = std::move(live);
+    deadNodes = 0;
+    flattened = false;
+}
+
+void IncrementalProgram::compactText() {
+    std::string live;
+    live.reserve(texts.size() - deadBytes);
+    forEach(root, [&](uint32_t element) {
+        uint64_t start = live.size();
+        live.append(texts, elements[element].text, elements[element].own.bytes);
+        elements[element].text = start;
+    });
+    texts = std::move(live);
+    deadBytes = 0;
+}
+
+// Treap: the elements in source order, as a binary tree with every parent's
+// priority above its children's, which keeps it O(log n) deep
+
+uint32_t IncrementalProgram::newElement(NodeIndex statement, uint64_t text, const Extent& own,
+                                        uint32_t line, uint32_t column) {
+    // xorshift32
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    Element element{statement, text, own, own, line, column, seed, NO_ELEMENT, NO_ELEMENT, NO_ELEMENT};
+    if (!freeElements.empty()) {
+        uint32_t index = freeElements.back();
+        freeElements.pop_back();
+        elements[index] = element;
+        return index;
+    }
+    elements.push_back(element);
+    return static_cast<uint32_t>(elements.size() - 1);
+}
+
+const IncrementalProgram::Extent& IncrementalProgram::totalOf(uint32_t element) const {
+    static const Extent EMPTY{0, 0, 0, 0};
+    return element == NO_ELEMENT ? EMPTY : elements[element].total;
+}
+
+void IncrementalProgram::pull(uint32_t index) {
+    Element& element = elements[index];
+    const Extent& left = totalOf(element.left);
+    const Extent& right = totalOf(element.right);
+    element.total.elements = left.elements + 1 + right.elements;
+    element.total.lineBreaks = left.lineBreaks + element.own.lineBreaks + right.lineBreaks;
+    element.total.bytes = left.bytes + element.own.bytes + right.bytes;
+    if (right.lineBreaks > 0) {
+        element.total.lastLine = right.lastLine;
+    } else if (element.own.lineBreaks > 0) {
+        element.total.lastLine = element.own.lastLine + right.bytes;
+    } else {
+        element.total.lastLine = left.lastLine + element.own.bytes + right.bytes;
+    }
+    if (element.left != NO_ELEMENT) {
+        elements[element.left].parent = index;
+    }
+    if (element.right != NO_ELEMENT) {
+        elements[element.right].parent = index;
+    }
+}
+
+uint32_t IncrementalProgram::merge(uint32_t left, uint32_t right) {
+    if (left == NO_ELEMENT) {
+        return right;
+    }
+    if (right == NO_ELEMENT) {
+        return left;
+    }
+    if (elements[left].priority > elements[right].priority) {
+        elements[left].right = merge(elements[left].right, right);
+        pull(left);
+        return left;
+    }
+    elements[right].left = merge(left, elements[right].left);
+    pull(right);
+    return right;
+}
+
+void IncrementalProgram::split(uint32_t tree, size_t count, uint32_t& left, uint32_t& right) {
+    // The first count elements go to left, the rest to right
+    if (tree == NO_ELEMENT) {
+        left = NO_ELEMENT;
+        right = NO_ELEMENT;
+        return;
+    }
+    size_t leftCount = totalOf(elements[tree].left).elements;
+    if (count <= leftCount) {
+        split(elements[tree].left, count, left, elements[tree].left);
+        pull(tree);
+        right = tree;
+    } else {
+        split(elements[tree].right, count - leftCount - 1, elements[tree].right, right);
+        pull(tree);
+        left = tree;
+    }
+}
+
+size_t IncrementalProgram::elementAt(uint64_t offset) const {
+    // At or past the end: the text after the last statement
+    const Extent& whole = totalOf(root);
+    if (offset >= whole.bytes) {
+        return whole.elements - 1;
+    }
+    size_t position = 0;
+    uint32_t index = root;
+    for (;;) {
+        const Element& element = elements[index];
+        const Extent& left = totalOf(element.left);
+        if (offset < left.bytes) {
+            index = element.left;
+            continue;
+        }
+        offset -= left.bytes;
+        position += left.elements;
+        if (offset < element.own.bytes) {
+            return position;
+        }
+        offset -= element.own.bytes;
+        position++;
+        index = element.right;
+    }
+}
+
+size_t IncrementalProgram::positionOf(uint32_t element) const {
+    size_t position = totalOf(elements[element].left).elements;
+    for (uint32_t child = element, parent = elements[element].parent; parent != NO_ELEMENT;
+         child = parent, parent = elements[parent].parent) {
+        if (elements[parent].right == child) {
+            position += totalOf(elements[parent].left).elements + 1;
+        }
+    }
+    return position;
+}
@@ -0,0 +1,160 @@
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "AST.h"
+#include "Token.h"
+
+/**
+ * IncrementalProgram - A parsed program that follows edits to its source.
+ *
+ * Purpose: Re-parses only what an edit touched, so saving a one-line
+ * change to a very large script does not lex and parse the whole file
+ * again (used by "--watch").
+ *
+ * How it works:
+ * A MidLang program is a flat list of ';'-terminated statements, and ';'
+ * is a token of its own, so every statement can be lexed and parsed
+ * without looking at its neighbours. The source is kept as one piece of
+ * text per statement (its leading whitespace included), plus one for
+ * the text after the last statement. The pieces are the elements of a
+ * treap in source order. Each element also holds the byte, line break
+ * and element counts of its subtree, so finding the element at an
+ * offset, the line and column it starts at, or its position in the
+ * program takes O(log n).
+ * 1. edit() splits off the elements the edited range overlaps. Their text,
+ *    with the edit applied, is lexed and parsed again, starting at the line
+ *    and column the first of them starts at. If the edit removed a ';',
+ *    parsing takes in the following elements one at a time, until it is
+ *    back in step with an element boundary
+ * 2. The new elements are joined in place of the old ones. Nothing after
+ *    them is touched: their offsets and lines follow from the counts
+ * 3. Only the new statements are resolved: a name keeps its slot across
+ *    edits, and for every slot the program remembers the element of the
+ *    first statement that assigns it, so a read is valid if that element
+ *    comes first. If an edit removes the first assignment of a variable,
+ *    or reads an undefined one, the whole program goes through the
+ *    Resolver instead (which renumbers the slots and reports the error as
+ *    usual)
+ *
+ * An edit of e bytes that touches statements of k bytes, in a program of
+ * n statements, thus costs O(e + k) to lex and parse, plus O(log n) for
+ * each statement parsed and each variable they read. update() compares
+ * the whole text with the last one first to find the edit, so it costs
+ * O(size of the file) on top of that.
+ *
+ * The texts and nodes of replaced statements stay in their arenas until
+ * they make up half of them, and are then dropped by copying the live
+ * ones, which costs no more per edit on average.
+ *
+ * current() writes the statements, in order, to the ProgramNode's
+ * statement list, and moves the locations of nodes whose statement now
+ * starts at another line or column. That is one pass over the statements
+ * (and over the nodes that moved), less than running them.
+ *
+ * If the edited text does not lex or parse, edit() throws and the
+ * program stays as it was before the edit. If it parses but reads an
+ * undefined variable, the edit is kept (the next one may fix it) and
+ * edit() throws the Resolver's error.
+ */
+class IncrementalProgram {
+private:
+    // Sizes of a run of text
+    struct Extent {
+        uint32_t elements;
+        uint32_t lineBreaks;
+        uint64_t bytes;
+        uint64_t lastLine;      // Bytes after the last line break, or all of them if there is none
+    };
+
+    // A statement's text, and the node of the treap it is in
+    struct Element {
+        NodeIndex statement;    // NO_NODE for the text after the last statement
+        uint64_t text;          // Start of the text in texts
+        Extent own;             // Of the text alone
+        Extent total;           // Of this element's subtree
+        uint32_t line;          // Where the statement started when its nodes were located
+        uint32_t column;
+        uint32_t priority;
+        uint32_t left;
+        uint32_t right;
+        uint32_t parent;
+    };
+
+    std::string source;     // The text update() last saw, if sourceCurrent
+    bool sourceCurrent;     // No edit() since
+    ProgramNode program;
+    TokenBuffer tokens;     // Refilled for every statement; keeps the symbols of program
+    std::string texts;      // Every element's text, in no particular order
+    std::vector<Element> elements;
+    std::vector<uint32_t> freeElements;
+    uint32_t root;
+    uint32_t seed;          // For element priorities
+    size_t deadBytes;       // Text of replaced elements still in texts
+    size_t deadNodes;       // Nodes of replaced statements still in the arena
+    bool flattened;         // program.statements and locations are up to date
+    TreeWalker walker;
+    std::vector<uint32_t> stack;
+
+    // Resolution state, valid when resolved is true
+    std::vector<int32_t> slots;              // Symbol -> slot, or -1
+    std::vector<uint32_t> firstAssignments;  // Slot -> element of the first statement assigning it
+    bool resolved;
+
+    // Treap
+    uint32_t newElement(NodeIndex statement, uint64_t text, const Extent& own, uint32_t line, uint32_t column);
+    const Extent& totalOf(uint32_t element) const;
+    void pull(uint32_t element);
+    uint32_t merge(uint32_t left, uint32_t right);
+    void split(uint32_t tree, size_t count, uint32_t& left, uint32_t& right);
+    size_t elementAt(uint64_t offset) const;
+    size_t positionOf(uint32_t element) const;
+    template <typename Visit> void forEach(uint32_t tree, Visit visit);
+
+    void flatten();
+    void compact();
+    void compactText();
+    void resolveAll();
+    bool resolveStatements(size_t first, const std::vector<uint32_t>& added);
+    bool resolveExpression(NodeIndex index, size_t position);
+
+public:
+    /**
+     * How much work the last update() did.
+     */
+    struct EditStats {
+        size_t statements;  // Statements parsed
+        size_t bytes;       // Bytes of source lexed
+    };
+
+    IncrementalProgram();
+
+    /**
+     * Replaces the source with text, re-parsing and resolving only the
+     * statements the change touches. Throws LexError or
+     * ParseError if the result is invalid; current() must not be run
+     * until an update() succeeds.
+     */
+    EditStats update(std::string_view text);
+
+    /**
+     * Replaces removed bytes at offset with inserted; otherwise as update().
+     */
+    EditStats edit(size_t offset, size_t removed, std::string_view inserted);
+
+    /**
+     * The current program, resolved and ready for any engine that does
+     * not change it (the Evaluator, Compiler, ClosureEngine or JIT).
+     */
+    ProgramNode& current();
+
+    /**
+     * The current source, put together from its pieces.
+     */
+    std::string text();
+};
+
+#endif // INCREMENTAL_H
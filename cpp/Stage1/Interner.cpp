@@ -0,0 +1,57 @@
+#include "Interner.h"
+
+// Hash table entries to start with (a power of two)
+static const size_t INITIAL_TABLE_SIZE = 64;
+
+Interner::Interner() : starts{0}, table(INITIAL_TABLE_SIZE, Entry{0, 0}) {
+    intern("var");
+    intern("print");
+    intern("inputInt");
+}
+
+uint32_t Interner::hash(std::string_view name) {
+    // FNV-1a: identifiers are short, so a simple byte-at-a-time hash is enough
+    uint32_t value = 2166136261u;
+    for (char c : name) {
+        value = (value ^ static_cast<unsigned char>(c)) * 16777619u;
+    }
+    return value;
+}
+
+uint32_t Interner::intern(std::string_view name) {
+    uint32_t nameHash = hash(name);
+    size_t mask = table.size() - 1;
+    size_t entry = nameHash & mask;
+    while (table[entry].symbol != 0) {
+        uint32_t symbol = table[entry].symbol - 1;
+        if (table[entry].hash == nameHash && this->name(symbol) == name) {
+            return symbol;
+        }
+        entry = (entry + 1) & mask;
+    }
+
+    uint32_t symbol = static_cast<uint32_t>(size());
+    text.append(name);
+    starts.push_back(static_cast<uint32_t>(text.size()));
+    table[entry] = Entry{nameHash, symbol + 1};
+    if (size() * 2 > table.size()) {
+        grow();
+    }
+    return symbol;
+}
+
+void Interner::grow() {
+    std::vector<Entry> old(table.size() * 2, Entry{0, 0});
+    old.swap(table);
+    size_t mask = table.size() - 1;
+    for (const Entry& moved : old) {
+        if (moved.symbol == 0) {
+            continue;
+        }
+        size_t entry = moved.hash & mask;
+        while (table[entry].symbol != 0) {
+            entry = (entry + 1) & mask;
+        }
+        table[entry] = moved;
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef INTERNER_H
+#define INTERNER_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Interner (Symbol Table of Names)
+ *
+ * Purpose: Stores each distinct identifier once and gives it a symbol, a
+ * small dense number. The lexer interns every identifier it reads, and
+ * from then on tokens, tree nodes and the resolver refer to the name by
+ * its symbol, so no later stage copies, compares or hashes the text again.
+ *
+ * How it works:
+ * 1. The characters of every name are appended to one buffer; symbol s
+ *    is the text between starts[s] and starts[s + 1]
+ * 2. An open-addressing hash table (linear probing, kept at most half
+ *    full) finds the symbol of a name already seen
+ * 3. The keywords are interned first, by the constructor, so their
+ *    symbols are fixed: the lexer recognizes a keyword by its symbol
+ *    being below KEYWORD_COUNT instead of comparing strings
+ *
+ * Memory grows with the number of distinct names, not with the number of
+ * times they appear. Symbols are never removed.
+ */
+class Interner {
+private:
+    // A hash table entry. The hash is kept next to the symbol so most
+    // probes are rejected without looking at the name.
+    struct Entry {
+        uint32_t hash;
+        uint32_t symbol;    // Symbol + 1, or 0 if the entry is empty
+    };
+
+    std::string text;               // Every name, back to back
+    std::vector<uint32_t> starts;   // Symbol -> start of its name in text, plus the end
+    std::vector<Entry> table;
+
+    static uint32_t hash(std::string_view name);
+    void grow();
+
+public:
+    // Symbols of the keywords, in the order the constructor interns them
+    static const uint32_t VAR = 0;
+    static const uint32_t PRINT = 1;
+    static const uint32_t INPUT_INT = 2;
+    static const uint32_t KEYWORD_COUNT = 3;
+
+    Interner();
+
+    /**
+     * Returns the symbol of name, adding it if it is new.
+     */
+    uint32_t intern(std::string_view name);
+
+    /**
+     * The name of a symbol. The view is invalidated by the next intern().
+     */
+    std::string_view name(uint32_t symbol) const {
+        return std::string_view(text).substr(starts[symbol], starts[symbol + 1] - starts[symbol]);
+    }
+
+    /**
+     * Number of symbols, keywords included.
+     */
+    size_t size() const { return starts.size() - 1; }
+};
+
+#endif // INTERNER_H
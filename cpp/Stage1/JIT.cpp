@@ -0,0 +1,327 @@
+#include "JIT.h"
+#include "Errors.h"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#define MIDLANG_HAVE_JIT 1
+#endif
+
+// Status codes returned by the generated code
+static const int STATUS_OK = 0;
+static const int STATUS_DIVISION_BY_ZERO = 1;
+static const int STATUS_CALLBACK_FAILED = 2;
+
+// inputCallback's return value when it failed (any int32_t is a value)
+static const int64_t INPUT_FAILED = INT64_MIN;
+
+#ifdef MIDLANG_HAVE_JIT
+
+/**
+ * CodeGenerator - Emits x86-64 machine code for one program.
+ *
+ * Register use in the generated function
+ * int jitted(int32_t* slots, JIT* jit):
+ *   rbx  slots (frame array)        r12  jit, for the callbacks
+ *   rbp  stack pointer on entry     eax  value of the current expression
+ *   ecx  right operand
+ * Intermediate values are pushed on the machine stack. rbx, r12 and rbp
+ * are callee-saved, so they survive the callbacks.
+ */
+class CodeGenerator {
+private:
+    const ProgramNode& program;
+    std::vector<uint8_t> bytes;
+    size_t pushed;                      // Values currently pushed by expressions
+    std::vector<size_t> divisionJumps;  // rel32 fields to patch with the error stubs
+    std::vector<size_t> callbackJumps;
+    const void* printFunction;
+    const void* inputFunction;
+
+    void emit(std::initializer_list<uint8_t> values) { bytes.insert(bytes.end(), values); }
+
+    void emit32(uint32_t value) {
+        for (int i = 0; i < 4; i++) bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    void emit64(uint64_t value) {
+        for (int i = 0; i < 8; i++) bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    static uint32_t slotOffset(int32_t slot) { return static_cast<uint32_t>(slot) * 4; }
+
+    // jcc/jmp with a 32-bit displacement, patched later
+    void jumpTo(std::vector<size_t>& fixups, std::initializer_list<uint8_t> opcode) {
+        emit(opcode);
+        fixups.push_back(bytes.size());
+        emit32(0);
+    }
+
+    void patch(const std::vector<size_t>& fixups, size_t target) {
+        for (size_t at : fixups) {
+            uint32_t displacement = static_cast<uint32_t>(target - (at + 4));
+            std::memcpy(&bytes[at], &displacement, 4);
+        }
+    }
+
+    // call a C++ function, keeping the stack 16-byte aligned
+    void call(const void* function) {
+        bool misaligned = (pushed % 2) != 0;
+        if (misaligned) emit({0x48, 0x83, 0xEC, 0x08});            // sub rsp, 8
+        emit({0x4C, 0x89, 0xE7});                                  // mov rdi, r12
+        emit({0x48, 0xB8});                                        // mov rax, imm64
+        emit64(reinterpret_cast<uint64_t>(function));
+        emit({0xFF, 0xD0});                                        // call rax
+        if (misaligned) emit({0x48, 0x83, 0xC4, 0x08});            // add rsp, 8
+    }
+
+    // eax = eax / ecx, failing when ecx is zero if checked
+    void divide(bool checked) {
+        if (checked) {
+            emit({0x85, 0xC9});                                    // test ecx, ecx
+            jumpTo(divisionJumps, {0x0F, 0x84});                   // jz division error
+        }
+        emit({0x99});                                              // cdq
+        emit({0xF7, 0xF9});                                        // idiv ecx
+    }
+
+    void statement(const Node& node);
+    void expression(NodeIndex index);
+    void binary(const Node& node);
+
+public:
+    explicit CodeGenerator(const ProgramNode& program) : program(program), pushed(0), printFunction(nullptr), inputFunction(nullptr) {}
+
+    std::vector<uint8_t> generate(const void* print, const void* input);
+};
+
+std::vector<uint8_t> CodeGenerator::generate(const void* print, const void* input) {
+    // Prologue: three pushes leave the stack 16-byte aligned
+    emit({0x53});                                                  // push rbx
+    emit({0x41, 0x54});                                            // push r12
+    emit({0x55});                                                  // push rbp
+    emit({0x48, 0x89, 0xE5});                                      // mov rbp, rsp
+    emit({0x48, 0x89, 0xFB});                                      // mov rbx, rdi
+    emit({0x49, 0x89, 0xF4});                                      // mov r12, rsi
+
+    printFunction = print;
+    inputFunction = input;
+    for (NodeIndex index : program.statements) {
+        statement(program[index]);
+    }
+
+    emit({0x31, 0xC0});                                            // xor eax, eax (STATUS_OK)
+    size_t epilogue = bytes.size();
+    emit({0x48, 0x89, 0xEC});                                      // mov rsp, rbp
+    emit({0x5D});                                                  // pop rbp
+    emit({0x41, 0x5C});                                            // pop r12
+    emit({0x5B});                                                  // pop rbx
+    emit({0xC3});                                                  // ret
+
+    // Error stubs: set the status and leave through the epilogue
+    std::vector<size_t> exitJumps;
+    patch(divisionJumps, bytes.size());
+    emit({0xB8});                                                  // mov eax, status
+    emit32(STATUS_DIVISION_BY_ZERO);
+    jumpTo(exitJumps, {0xE9});                                     // jmp exit
+    patch(callbackJumps, bytes.size());
+    emit({0xB8});
+    emit32(STATUS_CALLBACK_FAILED);
+    jumpTo(exitJumps, {0xE9});
+    patch(exitJumps, epilogue);
+
+    return std::move(bytes);
+}
+
+void CodeGenerator::statement(const Node& node) {
+    expression(node.left);
+    switch (node.kind) {
+        case NodeKind::VAR_DECLARATION:
+        case NodeKind::ASSIGNMENT:
+            emit({0x89, 0x83});                                    // mov [rbx + slot], eax
+            emit32(slotOffset(node.slot));
+            break;
+        case NodeKind::PRINT:
+            emit({0x89, 0xC6});                                    // mov esi, eax
+            call(printFunction);
+            emit({0x85, 0xC0});                                    // test eax, eax
+            jumpTo(callbackJumps, {0x0F, 0x85});                   // jnz callback error
+            break;
+        default:
+            throw std::runtime_error("Unknown statement type");
+    }
+}
+
+void CodeGenerator::expression(NodeIndex index) {
+    const Node& node = program[index];
+    switch (node.kind) {
+        case NodeKind::INTEGER_LITERAL:
+            emit({0xB8});                                          // mov eax, imm32
+            emit32(static_cast<uint32_t>(node.value));
+            break;
+        case NodeKind::VARIABLE_REFERENCE:
+            emit({0x8B, 0x83});                                    // mov eax, [rbx + slot]
+            emit32(slotOffset(node.slot));
+            break;
+        case NodeKind::INPUT_INT:
+            call(inputFunction);
+            emit({0x48, 0xB9});                                    // mov rcx, INPUT_FAILED
+            emit64(static_cast<uint64_t>(INPUT_FAILED));
+            emit({0x48, 0x39, 0xC8});                              // cmp rax, rcx
+            jumpTo(callbackJumps, {0x0F, 0x84});                   // je callback error
+            break;
+        case NodeKind::BINARY_EXPRESSION:
+            binary(node);
+            break;
+        default:
+            throw std::runtime_error("Unknown expression type");
+    }
+}
+
+void CodeGenerator::binary(const Node& node) {
+    expression(node.left);
+    const Node& right = program[node.right];
+
+    // Literal and variable operands are used in place
+    if (right.kind == NodeKind::INTEGER_LITERAL) {
+        uint32_t value = static_cast<uint32_t>(right.value);
+        switch (node.op) {
+            case BinaryOp::ADD: emit({0x05}); emit32(value); return;         // add eax, imm32
+            case BinaryOp::SUBTRACT: emit({0x2D}); emit32(value); return;         // sub eax, imm32
+            case BinaryOp::MULTIPLY: emit({0x69, 0xC0}); emit32(value); return;   // imul eax, eax, imm32
+            case BinaryOp::DIVIDE:
+                emit({0xB9}); emit32(value);                       // mov ecx, imm32
+                divide(right.value == 0);
+                return;
+        }
+    } else if (right.kind == NodeKind::VARIABLE_REFERENCE) {
+        uint32_t offset = slotOffset(right.slot);
+        switch (node.op) {
+            case BinaryOp::ADD: emit({0x03, 0x83}); emit32(offset); return;        // add eax, [rbx + slot]
+            case BinaryOp::SUBTRACT: emit({0x2B, 0x83}); emit32(offset); return;        // sub eax, [rbx + slot]
+            case BinaryOp::MULTIPLY: emit({0x0F, 0xAF, 0x83}); emit32(offset); return;  // imul eax, [rbx + slot]
+            case BinaryOp::DIVIDE:
+                emit({0x8B, 0x8B}); emit32(offset);                      // mov ecx, [rbx + slot]
+                divide(!(node.flags & Node::DIVISOR_NONZERO));
+                return;
+        }
+    } else {
+        emit({0x50});                                              // push rax
+        pushed++;
+        expression(node.right);
+        emit({0x89, 0xC1});                                        // mov ecx, eax
+        emit({0x58});                                              // pop rax
+        pushed--;
+        switch (node.op) {
+            case BinaryOp::ADD: emit({0x01, 0xC8}); return;                  // add eax, ecx
+            case BinaryOp::SUBTRACT: emit({0x29, 0xC8}); return;                  // sub eax, ecx
+            case BinaryOp::MULTIPLY: emit({0x0F, 0xAF, 0xC1}); return;            // imul eax, ecx
+            case BinaryOp::DIVIDE: divide(!(node.flags & Node::DIVISOR_NONZERO)); return;
+        }
+    }
+
+    std::stringstream ss;
+    ss << "Unknown operator: " << symbolOf(node.op);
+    throw std::runtime_error(ss.str());
+}
+
+#endif // MIDLANG_HAVE_JIT
+
+JIT::JIT(OutputSink& output, InputSource& input)
+    : output(output), input(input), code(nullptr), codeSize(0) {}
+
+JIT::~JIT() {
+    release();
+}
+
+bool JIT::isSupported() {
+#ifdef MIDLANG_HAVE_JIT
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool JIT::canRun(const ProgramNode& program) {
+    TreeWalker walker;
+    return isSupported() && walker.height(program) <= MAX_DEPTH;
+}
+
+void JIT::release() {
+#ifdef MIDLANG_HAVE_JIT
+    if (code != nullptr) {
+        munmap(code, codeSize);
+    }
+#endif
+    code = nullptr;
+    codeSize = 0;
+}
+
+int32_t JIT::printCallback(JIT* jit, int32_t value) {
+    try {
+        jit->output.writeInt(value);
+        return 0;
+    } catch (...) {
+        jit->pending = std::current_exception();
+        return 1;
+    }
+}
+
+int64_t JIT::inputCallback(JIT* jit) {
+    try {
+        return jit->input.readInt();
+    } catch (...) {
+        jit->pending = std::current_exception();
+        return INPUT_FAILED;
+    }
+}
+
+void JIT::compile(const ProgramNode& program) {
+#ifdef MIDLANG_HAVE_JIT
+    release();
+    CodeGenerator generator(program);
+    std::vector<uint8_t> bytes = generator.generate(reinterpret_cast<const void*>(&JIT::printCallback),
+                                                    reinterpret_cast<const void*>(&JIT::inputCallback));
+
+    // Write the code while the pages are writable, then make them executable
+    size_t size = bytes.size();
+    void* pages = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pages == MAP_FAILED) {
+        throw std::runtime_error("JIT: cannot map memory for generated code");
+    }
+    std::memcpy(pages, bytes.data(), size);
+    if (mprotect(pages, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(pages, size);
+        throw std::runtime_error("JIT: cannot make generated code executable");
+    }
+    code = pages;
+    codeSize = size;
+    slots.assign(program.slotNames.size(), 0);
+#else
+    (void)program;
+    throw std::runtime_error("JIT: not supported on this platform");
+#endif
+}
+
+void JIT::run() {
+    if (code == nullptr) {
+        throw std::runtime_error("JIT: no program compiled");
+    }
+    using Function = int (*)(int32_t*, JIT*);
+    std::fill(slots.begin(), slots.end(), 0);
+    pending = nullptr;
+
+    int status = reinterpret_cast<Function>(code)(slots.data(), this);
+    if (status == STATUS_OK) {
+        return;
+    }
+    if (status == STATUS_DIVISION_BY_ZERO) {
+        throw RuntimeError("Division by zero");
+    }
+    if (status == STATUS_CALLBACK_FAILED) {
+        std::rethrow_exception(pending);
+    }
+}
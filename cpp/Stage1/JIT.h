@@ -0,0 +1,83 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <cstdint>
+#include <exception>
+#include <vector>
+#include "AST.h"
+#include "IO.h"
+
+/**
+ * JIT (Native code generator)
+ *
+ * Purpose: Runs a program as x86-64 machine code, with none of the
+ * dispatch overhead of walking a tree or decoding bytecode.
+ *
+ * How it works:
+ * 1. compile() lowers every statement of a resolved program straight
+ *    into machine code, written into pages from mmap that are made
+ *    executable (and read-only) once the code is complete
+ * 2. Variables live in a frame array indexed by slot; the generated
+ *    code keeps its address in a register
+ * 3. print and inputInt() call back into C++ (OutputSink, InputSource)
+ * 4. Errors leave the generated code through a status code, since C++
+ *    exceptions cannot unwind through it: run() turns the status back
+ *    into the same exception the other engines throw ("Division by
+ *    zero", or whatever a callback threw)
+ *
+ * Only x86-64 Linux is supported; isSupported() says whether this build
+ * can use the JIT. Code generation recurses once per level of nesting,
+ * and the generated code pushes one value per level, so programs nested
+ * deeper than MAX_DEPTH are not compiled either; canRun() checks both.
+ * Callers fall back to the Evaluator when it says no.
+ */
+class JIT {
+private:
+    OutputSink& output;
+    InputSource& input;
+
+    void* code;                 // Executable mapping, or nullptr
+    size_t codeSize;
+    std::vector<int32_t> slots;
+    std::exception_ptr pending; // Thrown by a callback, rethrown by run()
+
+    // Called from the generated code
+    static int32_t printCallback(JIT* jit, int32_t value);
+    static int64_t inputCallback(JIT* jit);
+
+    void release();
+
+public:
+    static const size_t MAX_DEPTH = 10000;
+
+    JIT(OutputSink& output, InputSource& input);
+    ~JIT();
+
+    JIT(const JIT&) = delete;
+    JIT& operator=(const JIT&) = delete;
+
+    /**
+     * Whether this build and host can run generated code.
+     */
+    static bool isSupported();
+
+    /**
+     * Whether the JIT can run this program: the host is supported and no
+     * statement is nested more than MAX_DEPTH levels deep.
+     */
+    static bool canRun(const ProgramNode& program);
+
+    /**
+     * Generates code for a program that has been through the Resolver.
+     * Throws std::runtime_error if the host is not supported or the
+     * code cannot be mapped.
+     */
+    void compile(const ProgramNode& program);
+
+    /**
+     * Runs the compiled program from the start, with every variable at zero.
+     */
+    void run();
+};
+
+#endif // JIT_H
@@ -1,131 +1,179 @@
 #include "Lexer.h"
+#include "Errors.h"
 #include <cctype>
-#include <sstream>
 
-Lexer::Lexer(const std::string& source)
-    : source(source), position(0), line(1), column(1) {}
+// Token type of each keyword, indexed by the keyword's symbol
+static const TokenType KEYWORD_TYPES[Interner::KEYWORD_COUNT] = {
+    TokenType::VAR,         // Interner::VAR
+    TokenType::PRINT,       // Interner::PRINT
+    TokenType::INPUT_INT,   // Interner::INPUT_INT
+};
 
-std::vector<Token> Lexer::tokenize() {
-    std::vector<Token> tokens;
+// The characters ScanKernels::skipSpace skips
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+Lexer::Lexer(std::string_view source, const ScanKernels& scan)
+    : source(source), scan(scan), position(0), windowStart(0), line(1), column(1) {}
+
+Lexer::Lexer(std::string_view source, size_t start, uint32_t line, uint32_t column, const ScanKernels& scan)
+    : source(source), scan(scan), position(start), windowStart(start), line(line), column(column) {}
+
+TokenBuffer Lexer::tokenize() {
+    // Offsets count from where the lexer starts, so they fit in 32 bits
+    // as long as the part being read does
+    if (source.size() - windowStart >= UINT32_MAX) {
+        throw LexError("Source file too large");
+    }
+
+    TokenBuffer tokens;
+    tokens.source = source.substr(windowStart);
 
     while (!isAtEnd()) {
         skipWhitespace();
         if (isAtEnd()) break;
 
-        Token token = nextToken();
-        tokens.push_back(token);
+        nextToken(tokens);
 
         // Stop if we hit an error token
-        if (token.type == TokenType::UNKNOWN) {
+        if (tokens.types.back() == TokenType::UNKNOWN) {
             break;
         }
     }
 
     // Add EOF token at the end
-    tokens.push_back(Token(TokenType::EOF_TOKEN, "", line, column));
+    tokens.push(TokenType::EOF_TOKEN, offsetOf(position), 0, line, column);
     return tokens;
 }
 
-Token Lexer::nextToken() {
+bool Lexer::tokenizeStatement(TokenBuffer& tokens) {
+    tokens.clear();
+    skipWhitespace();
+    if (isAtEnd()) {
+        return false;
+    }
+
+    // Offsets stay 32 bits wide by counting from the start of the statement
+    windowStart = position;
+
+    while (!isAtEnd()) {
+        nextToken(tokens);
+
+        TokenType type = tokens.types.back();
+        if (type == TokenType::SEMICOLON || type == TokenType::UNKNOWN) {
+            break;
+        }
+
+        skipWhitespace();
+    }
+
+    tokens.source = source.substr(windowStart, position - windowStart);
+    tokens.push(TokenType::EOF_TOKEN, offsetOf(position), 0, line, column);
+    return true;
+}
+
+void Lexer::nextToken(TokenBuffer& tokens) {
     char current = advance();
 
     // Single character tokens
     switch (current) {
-        case '+': return createToken(TokenType::PLUS);
-        case '-': return createToken(TokenType::MINUS);
-        case '*': return createToken(TokenType::MULTIPLY);
-        case '/': return createToken(TokenType::DIVIDE);
-        case '=': return createToken(TokenType::ASSIGN);
-        case ';': return createToken(TokenType::SEMICOLON);
-        case '(': return createToken(TokenType::LEFT_PAREN);
-        case ')': return createToken(TokenType::RIGHT_PAREN);
+        case '+': return createToken(tokens, TokenType::PLUS);
+        case '-': return createToken(tokens, TokenType::MINUS);
+        case '*': return createToken(tokens, TokenType::MULTIPLY);
+        case '/': return createToken(tokens, TokenType::DIVIDE);
+        case '=': return createToken(tokens, TokenType::ASSIGN);
+        case ';': return createToken(tokens, TokenType::SEMICOLON);
+        case '(': return createToken(tokens, TokenType::LEFT_PAREN);
+        case ')': return createToken(tokens, TokenType::RIGHT_PAREN);
     }
 
     // Numbers (integers)
-    if (std::isdigit(current)) {
-        return readNumber();
+    if (std::isdigit(static_cast<unsigned char>(current))) {
+        return readNumber(tokens);
     }
 
     // Identifiers and keywords
-    if (std::isalpha(current) || current == '_') {
-        return readIdentifier();
+    if (std::isalpha(static_cast<unsigned char>(current)) || current == '_') {
+        return readIdentifier(tokens);
     }
 
     // Unknown character
-    return Token(TokenType::UNKNOWN, std::string(1, current), line, column);
+    tokens.push(TokenType::UNKNOWN, offsetOf(position - 1), 1, line, column);
 }
 
-Token Lexer::readNumber() {
-    int startColumn = column - 1;
-    std::stringstream number;
+void Lexer::readNumber(TokenBuffer& tokens) {
+    size_t start = position - 1;
+    uint32_t startColumn = column - 1;
 
-    // Read digits (we've already consumed the first digit)
-    number << source[position - 1];
+    // Find the end of the digits, then decode them (we've already consumed the first digit)
+    int64_t value = source[start] - '0';
+    bool outOfRange = false;
 
-    // Read remaining digits
-    while (!isAtEnd() && std::isdigit(peek())) {
-        number << advance();
+    const char* digits = source.data() + position;
+    const char* end = scan.skipDigits(digits, source.data() + source.size());
+    for (const char* digit = digits; digit < end && !outOfRange; digit++) {
+        value = value * 10 + (*digit - '0');
+        outOfRange = value > INT32_MAX;
     }
+    position += end - digits;
+    column += static_cast<uint32_t>(end - digits);
 
-    return Token(TokenType::INTEGER, number.str(), line, startColumn);
+    // Reported by the Parser, in source order with the other errors
+    tokens.push(TokenType::INTEGER, offsetOf(start),
+                static_cast<uint32_t>(position - start), line, startColumn,
+                outOfRange ? TokenBuffer::OUT_OF_RANGE : static_cast<int32_t>(value));
 }
 
-Token Lexer::readIdentifier() {
-    int startColumn = column - 1;
-    std::stringstream identifier;
-
-    // Read first character (already consumed)
-    identifier << source[position - 1];
+void Lexer::readIdentifier(TokenBuffer& tokens) {
+    size_t start = position - 1;
+    uint32_t startColumn = column - 1;
 
-    // Read remaining letters, digits, and underscores
-    while (!isAtEnd() && (std::isalnum(peek()) || peek() == '_')) {
-        identifier << advance();
-    }
+    // Read remaining letters, digits, and underscores (first character already consumed)
+    const char* rest = source.data() + position;
+    const char* end = scan.skipWord(rest, source.data() + source.size());
+    position += end - rest;
+    column += static_cast<uint32_t>(end - rest);
 
-    std::string value = identifier.str();
+    std::string_view value = source.substr(start, position - start);
 
-    // Check if it's a keyword
-    TokenType type;
-    if (value == "var") {
-        type = TokenType::VAR;
-    } else if (value == "print") {
-        type = TokenType::PRINT;
-    } else if (value == "inputInt") {
-        type = TokenType::INPUT_INT;
-    } else {
-        type = TokenType::IDENTIFIER;
+    // Keywords are interned first, so a keyword is any symbol below KEYWORD_COUNT
+    uint32_t symbol = tokens.symbols.intern(value);
+    if (symbol < Interner::KEYWORD_COUNT) {
+        tokens.push(KEYWORD_TYPES[symbol], offsetOf(start), static_cast<uint32_t>(value.size()),
+                    line, startColumn);
+        return;
     }
 
-    return Token(type, value, line, startColumn);
+    tokens.push(TokenType::IDENTIFIER, offsetOf(start), static_cast<uint32_t>(value.size()),
+                line, startColumn, static_cast<int32_t>(symbol));
 }
 
 void Lexer::skipWhitespace() {
-    while (!isAtEnd()) {
-        char c = peek();
-        if (c == ' ' || c == '\t') {
-            advance();
-        } else if (c == '\r') {
-            // Handle Windows line endings (\r\n)
-            advance();
-            if (!isAtEnd() && peek() == '\n') {
-                advance(); // Skip the \n after \r
-            }
-            line++;
-            column = 1;
-        } else if (c == '\n') {
-            // Handle Unix line endings (\n)
-            advance();
-            line++;
-            column = 1;
-        } else {
-            break;
-        }
+    // Most runs are empty or a single space between two tokens, which is
+    // quicker to see here than through a call into the kernels
+    if (isAtEnd() || !isSpace(source[position])) {
+        return;
+    }
+    if (source[position] == ' ' && (position + 1 == source.size() || !isSpace(source[position + 1]))) {
+        position++;
+        column++;
+        return;
     }
-}
 
-char Lexer::peek() {
-    if (isAtEnd()) return '\0';
-    return source[position];
+    const char* start = source.data() + position;
+    const char* end = scan.skipSpace(start, source.data() + source.size());
+
+    // "\r\n", "\r" and "\n" each start a new line; the column counts from
+    // just after the last line break in the run
+    const char* lastBreak = nullptr;
+    line += static_cast<uint32_t>(scan.countLineBreaks(start, end, &lastBreak));
+    if (lastBreak != nullptr) {
+        column = static_cast<uint32_t>(end - lastBreak);
+    } else {
+        column += static_cast<uint32_t>(end - start);
+    }
+    position += end - start;
 }
 
 char Lexer::advance() {
@@ -138,8 +186,10 @@ bool Lexer::isAtEnd() {
     return position >= source.length();
 }
 
-Token Lexer::createToken(TokenType type) {
-    std::string value(1, source[position - 1]);
-    return Token(type, value, line, column - 1);
+void Lexer::createToken(TokenBuffer& tokens, TokenType type) {
+    tokens.push(type, offsetOf(position - 1), 1, line, column - 1);
 }
 
+uint32_t Lexer::offsetOf(size_t sourcePosition) {
+    return static_cast<uint32_t>(sourcePosition - windowStart);
+}
@@ -1,8 +1,8 @@
 #ifndef LEXER_H
 #define LEXER_H
 
-#include <vector>
-#include <string>
+#include <string_view>
+#include "ScanKernels.h"
 #include "Token.h"
 
 /**
@@ -11,36 +11,71 @@
  * Purpose: Converts source code into a stream of tokens.
  * 
  * How it works:
- * 1. Reads source code character by character
+ * 1. Reads source code character by character, except for runs of
+ *    whitespace, identifier characters and digits, whose end is found a
+ *    block of bytes at a time (see ScanKernels)
  * 2. Groups characters into meaningful tokens
  * 3. Skips whitespace
- * 4. Returns tokens one at a time
+ * 4. Records each token's position in the source instead of copying its text
  */
 class Lexer {
 private:
-    std::string source;
+    std::string_view source;  // Not owned: must outlive the Lexer and its tokens
+    const ScanKernels& scan;  // Finds the end of whitespace, identifiers and numbers
     size_t position;  // Current position in source
-    int line;         // Current line number
-    int column;       // Current column number
+    size_t windowStart;  // Source position that token offsets are relative to
+    uint32_t line;    // Current line number
+    uint32_t column;  // Current column number
 
     // Helper methods
-    char peek();
     char advance();
     bool isAtEnd();
     void skipWhitespace();
-    Token readNumber();
-    Token readIdentifier();
-    Token nextToken();
-    Token createToken(TokenType type);
+    void readNumber(TokenBuffer& tokens);
+    void readIdentifier(TokenBuffer& tokens);
+    void nextToken(TokenBuffer& tokens);
+    void createToken(TokenBuffer& tokens, TokenType type);
+    uint32_t offsetOf(size_t sourcePosition);
 
 public:
-    Lexer(const std::string& source);
+    /**
+     * scan is normally the best kernels for this processor; any other
+     * kernels produce the same tokens.
+     */
+    Lexer(std::string_view source, const ScanKernels& scan = selectScanKernels());
+
+    /**
+     * Starts reading at byte start instead of the beginning, which is at
+     * the given line and column. Used to re-lex part of an edited source
+     * (see IncrementalProgram), and to lex one chunk of a large source
+     * (see ParallelFrontEnd), with source ending where the chunk does.
+     */
+    Lexer(std::string_view source, size_t start, uint32_t line, uint32_t column,
+          const ScanKernels& scan = selectScanKernels());
     
     /**
      * Tokenizes the entire source code and returns all tokens.
      */
-    std::vector<Token> tokenize();
+    TokenBuffer tokenize();
+
+    /**
+     * Tokenizes the next statement only, for streaming execution.
+     * Replaces the contents of tokens with everything up to and including
+     * the next ';' (or up to the end of the source), followed by an EOF
+     * token. Returns false once the source has no tokens left.
+     */
+    bool tokenizeStatement(TokenBuffer& tokens);
+
+    /**
+     * How far into the source the lexer has read.
+     */
+    size_t offset() const { return position; }
+
+    /**
+     * Line and column of offset().
+     */
+    uint32_t currentLine() const { return line; }
+    uint32_t currentColumn() const { return column; }
 };
 
 #endif // LEXER_H
-
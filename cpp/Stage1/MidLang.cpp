@@ -0,0 +1,70 @@
+#include "MidLang.h"
+#include <stdexcept>
+#include "Lexer.h"
+#include "Parser.h"
+#include "Resolver.h"
+#include "Optimizer.h"
+#include "Compiler.h"
+
+namespace midlang {
+
+std::shared_ptr<const Program> Program::compile(std::string_view source, const CompileOptions& options) {
+    Lexer lexer(source);
+    TokenBuffer tokens = lexer.tokenize();
+    Parser parser(tokens);
+    std::unique_ptr<ProgramNode> ast = parser.parse();
+    Resolver resolver;
+    resolver.resolve(ast.get());
+    if (options.optimize) {
+        Optimizer optimizer;
+        optimizer.optimize(ast.get());
+    }
+    Compiler compiler;
+
+    // The constructor is private, so make_shared cannot be used
+    std::shared_ptr<Program> program(new Program());
+    program->bytecode = compiler.compile(ast.get());
+    program->names = std::move(ast->slotNames);
+    for (size_t slot = 0; slot < program->names.size(); slot++) {
+        program->slotsByName.emplace(program->names[slot], slot);
+    }
+    return program;
+}
+
+Session::Session(std::shared_ptr<const Program> program)
+    : program(std::move(program)),
+      output([this](int value) {
+          if (outputCallback) {
+              outputCallback(value);
+          }
+      }),
+      input([this]() {
+          if (!inputCallback) {
+              throw RuntimeError("Invalid integer input: ");
+          }
+          return inputCallback();
+      }),
+      vm(output, input) {}
+
+void Session::setOutput(std::function<void(int)> callback) {
+    outputCallback = std::move(callback);
+}
+
+void Session::setInput(std::function<int()> callback) {
+    inputCallback = std::move(callback);
+}
+
+void Session::run() {
+    vm.run(program->bytecode);
+}
+
+int Session::variable(const std::string& name) const {
+    auto it = program->slotsByName.find(name);
+    if (it == program->slotsByName.end()) {
+        throw std::out_of_range("No such variable: " + name);
+    }
+    const std::vector<int>& values = vm.variables();
+    return it->second < values.size() ? values[it->second] : 0;
+}
+
+} // namespace midlang
@@ -0,0 +1,123 @@
+#ifndef MIDLANG_H
+#define MIDLANG_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "Bytecode.h"
+#include "Errors.h"
+#include "IO.h"
+#include "VM.h"
+
+/**
+ * MidLang.h - Public API of the midlang library, for running MidLang
+ * programs inside another application.
+ *
+ * Purpose: Compile a program once and run it as often as needed without
+ * starting a process or parsing the source again.
+ *
+ * How it works:
+ * 1. midlang::Program::compile() runs the whole front end (lexer, parser,
+ *    resolver, optimizer, bytecode compiler) and returns an immutable
+ *    program. It is never modified afterwards, so one program can be
+ *    shared by any number of threads.
+ * 2. A midlang::Session runs a program. It holds the variables, the VM
+ *    stack and the input/output callbacks of one run at a time, and can
+ *    be reused for the next run. Sessions are cheap; use one per thread
+ *    (or per request) and never share one between threads.
+ *
+ * Errors are the exceptions of Errors.h: compile() throws LexError or
+ * ParseError, and Session::run() throws RuntimeError.
+ *
+ * Example:
+ *   auto program = midlang::Program::compile("var x = inputInt(); print(x * 2);");
+ *   midlang::Session session(program);
+ *   session.setInput([] { return 21; });
+ *   session.setOutput([](int value) { std::cout << value << "\n"; });
+ *   session.run();
+ */
+namespace midlang {
+
+/**
+ * CompileOptions - Choices made when a program is compiled.
+ */
+struct CompileOptions {
+    bool optimize = true;   // Run the Optimizer (see Optimizer.h)
+};
+
+/**
+ * Program - A compiled MidLang program. Immutable and thread-safe.
+ */
+class Program {
+private:
+    BytecodeProgram bytecode;
+    std::vector<std::string> names;                     // slot -> variable name
+    std::unordered_map<std::string, size_t> slotsByName;
+
+    Program() = default;
+    friend class Session;
+
+public:
+    /**
+     * Compiles source text. Throws LexError or ParseError if the program
+     * is not valid; nothing is run.
+     */
+    static std::shared_ptr<const Program> compile(std::string_view source,
+                                                  const CompileOptions& options = CompileOptions());
+
+    /**
+     * Names of the program's variables, in slot order.
+     */
+    const std::vector<std::string>& variables() const { return names; }
+};
+
+/**
+ * Session - One run (at a time) of a compiled program.
+ */
+class Session {
+private:
+    std::shared_ptr<const Program> program;
+    std::function<void(int)> outputCallback;
+    std::function<int()> inputCallback;
+    OutputSink output;                  // Forwards to outputCallback
+    InputSource input;                  // Asks inputCallback
+    VM vm;
+
+public:
+    explicit Session(std::shared_ptr<const Program> program);
+
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+
+    /**
+     * Sets where print() values go. By default they are discarded.
+     */
+    void setOutput(std::function<void(int)> callback);
+
+    /**
+     * Sets where inputInt() values come from. The callback may throw
+     * to fail the run. By default inputInt() fails as if the input had
+     * ended ("Invalid integer input: ").
+     */
+    void setInput(std::function<int()> callback);
+
+    /**
+     * Runs the program from the start with every variable at zero.
+     * Throws RuntimeError (or whatever a callback throws) on failure.
+     */
+    void run();
+
+    /**
+     * Value of a variable after (or during a failed) run.
+     * Throws std::out_of_range if the program has no such variable.
+     */
+    int variable(const std::string& name) const;
+};
+
+} // namespace midlang
+
+#endif // MIDLANG_H
@@ -0,0 +1,383 @@
+#include "Optimizer.h"
+#include "Arithmetic.h"
+#include <climits>
+
+static bool isSumOp(BinaryOp op) { return op == BinaryOp::ADD || op == BinaryOp::SUBTRACT; }
+
+// Whether an operand with operator inner belongs to the same chain as its
+// parent's operator outer
+static bool sameChain(BinaryOp outer, BinaryOp inner) {
+    return (isSumOp(outer) && isSumOp(inner)) || (outer == BinaryOp::MULTIPLY && inner == BinaryOp::MULTIPLY);
+}
+
+Optimizer::Optimizer() : program(nullptr), location{0, 0} {}
+
+size_t Optimizer::optimize(ProgramNode* program) {
+    this->program = program;
+
+    size_t before = 0;
+    for (NodeIndex statement : program->statements) {
+        before += countNodes(statement);
+    }
+
+    for (NodeIndex statement : program->statements) {
+        NodeIndex expression = optimizeExpression((*program)[statement].left);
+        (*program)[statement].left = expression;
+    }
+
+    // Copy the live nodes into a fresh arena. This drops the nodes that
+    // were folded away and keeps children next to their parents.
+    ProgramNode compacted;
+    size_t after = 0;
+    for (NodeIndex statement : program->statements) {
+        after += countNodes(statement);
+    }
+    compacted.nodes.reserve(after);
+    compacted.locations.reserve(after);
+    for (NodeIndex& statement : program->statements) {
+        statement = walker.copy(*program, compacted, statement);
+    }
+    program->nodes = std::move(compacted.nodes);
+    program->locations = std::move(compacted.locations);
+
+    this->program = nullptr;
+    return before - after;
+}
+
+NodeIndex Optimizer::optimizeExpression(NodeIndex root) {
+    // Bottom-up: a node is simplified once both operands are. Operands of
+    // the same chain (a + b - c, or a * b * c) are combined once, at the
+    // top of the chain, rather than at every level. The top is only known
+    // once the operands are rewritten (x / 1 -> x can join two sums into
+    // one chain), so a chain is combined when the node above it survives
+    // simplification, or at the root.
+    frames.clear();
+    results.clear();
+    frames.push_back(Frame{root, false});
+    while (!frames.empty()) {
+        Frame frame = frames.back();
+        const Node& node = (*program)[frame.index];
+        if (node.kind != NodeKind::BINARY_EXPRESSION) {
+            frames.pop_back();
+            results.push_back(frame.index);
+            continue;
+        }
+
+        if (!frame.expanded) {
+            frames.back().expanded = true;
+            // Pushed right first, so the left operand is done first
+            frames.push_back(Frame{node.right, false});
+            frames.push_back(Frame{node.left, false});
+            continue;
+        }
+
+        frames.pop_back();
+        NodeIndex newRight = results.back();
+        results.pop_back();
+        NodeIndex newLeft = results.back();
+        results.pop_back();
+        (*program)[frame.index].left = newLeft;
+        (*program)[frame.index].right = newRight;
+        NodeIndex simplified = simplify(frame.index);
+        if (simplified == frame.index && endChains(frame.index)) {
+            // An operand may have become a literal
+            simplified = simplify(frame.index);
+        }
+        results.push_back(simplified);
+    }
+    return reassociate(results.back());
+}
+
+bool Optimizer::endChains(NodeIndex index) {
+    // Operands that do not continue this node's chain are the tops of
+    // their own
+    bool changed = false;
+    for (bool leftSide : {true, false}) {
+        Node node = (*program)[index];
+        NodeIndex operand = leftSide ? node.left : node.right;
+        const Node& child = (*program)[operand];
+        if (child.kind != NodeKind::BINARY_EXPRESSION || sameChain(node.op, child.op)) {
+            continue;
+        }
+        NodeIndex combined = reassociate(operand);
+        if (combined != operand) {
+            // Looked up again: reassociating may have grown the arena
+            (leftSide ? (*program)[index].left : (*program)[index].right) = combined;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+NodeIndex Optimizer::reassociate(NodeIndex index) {
+    const Node& node = (*program)[index];
+    if (node.kind != NodeKind::BINARY_EXPRESSION) {
+        return index;
+    }
+    location = program->locations[index];
+    if (isSumOp(node.op)) {
+        return reassociateSum(index);
+    }
+    if (node.op == BinaryOp::MULTIPLY) {
+        return reassociateProduct(index);
+    }
+    return index;
+}
+
+NodeIndex Optimizer::simplify(NodeIndex index) {
+    // Nodes built while simplifying stand in for this one
+    location = program->locations[index];
+
+    Node node = (*program)[index];
+    const Node& left = (*program)[node.left];
+    const Node& right = (*program)[node.right];
+
+    // 1. Both operands known: compute the result now
+    if (left.kind == NodeKind::INTEGER_LITERAL && right.kind == NodeKind::INTEGER_LITERAL) {
+        int32_t a = left.value;
+        int32_t b = right.value;
+        switch (node.op) {
+            case BinaryOp::ADD: return literal(wrapAdd(a, b));
+            case BinaryOp::SUBTRACT: return literal(wrapSub(a, b));
+            case BinaryOp::MULTIPLY: return literal(wrapMul(a, b));
+            case BinaryOp::DIVIDE:
+                // Leave runtime errors (and the INT_MIN / -1 trap) to runtime
+                if (b == 0 || (a == INT_MIN && b == -1)) {
+                    return index;
+                }
+                return literal(a / b);
+        }
+    }
+
+    // 2. Identities
+    switch (node.op) {
+        case BinaryOp::ADD:
+            if (isLiteral(node.right, 0)) return node.left;
+            if (isLiteral(node.left, 0)) return node.right;
+            break;
+        case BinaryOp::SUBTRACT:
+            if (isLiteral(node.right, 0)) return node.left;
+            if (sameExpression(node.left, node.right) && isPure(node.left)) return literal(0);
+            break;
+        case BinaryOp::MULTIPLY:
+            if (isLiteral(node.right, 1)) return node.left;
+            if (isLiteral(node.left, 1)) return node.right;
+            if (isLiteral(node.right, 0) && isPure(node.left)) return literal(0);
+            if (isLiteral(node.left, 0) && isPure(node.right)) return literal(0);
+            break;
+        case BinaryOp::DIVIDE:
+            if (isLiteral(node.right, 1)) return node.left;
+            break;
+    }
+
+    return index;
+}
+
+NodeIndex Optimizer::reassociateSum(NodeIndex index) {
+    std::vector<Term> terms;
+    collectTerms(index, terms);
+
+    int32_t constant = 0;
+    size_t constants = 0;
+    for (const Term& term : terms) {
+        const Node& node = (*program)[term.node];
+        if (node.kind == NodeKind::INTEGER_LITERAL) {
+            constant = term.negative ? wrapSub(constant, node.value) : wrapAdd(constant, node.value);
+            constants++;
+        }
+    }
+    if (constants < 2) {
+        return index;
+    }
+
+    // Rebuild the chain with the other terms in their original order
+    NodeIndex result = NO_NODE;
+    bool constantUsed = false;
+    for (const Term& term : terms) {
+        if ((*program)[term.node].kind == NodeKind::INTEGER_LITERAL) {
+            continue;
+        }
+        if (result == NO_NODE) {
+            if (term.negative) {
+                // No unary minus in MidLang: start from the constant instead
+                result = binary(literal(constant), BinaryOp::SUBTRACT, term.node);
+                constantUsed = true;
+            } else {
+                result = term.node;
+            }
+        } else {
+            result = binary(result, term.negative ? BinaryOp::SUBTRACT : BinaryOp::ADD, term.node);
+        }
+    }
+
+    if (result == NO_NODE) {
+        return literal(constant);
+    }
+    if (!constantUsed && constant != 0) {
+        if (constant < 0 && constant != INT_MIN) {
+            result = binary(result, BinaryOp::SUBTRACT, literal(-constant));
+        } else {
+            result = binary(result, BinaryOp::ADD, literal(constant));
+        }
+    }
+    return result;
+}
+
+NodeIndex Optimizer::reassociateProduct(NodeIndex index) {
+    std::vector<NodeIndex> factors;
+    collectFactors(index, factors);
+
+    int32_t constant = 1;
+    size_t constants = 0;
+    for (NodeIndex factor : factors) {
+        const Node& node = (*program)[factor];
+        if (node.kind == NodeKind::INTEGER_LITERAL) {
+            constant = wrapMul(constant, node.value);
+            constants++;
+        }
+    }
+    if (constants < 2) {
+        return index;
+    }
+    if (constant == 0) {
+        bool pure = true;
+        for (NodeIndex factor : factors) {
+            pure = pure && isPure(factor);
+        }
+        if (pure) {
+            return literal(0);
+        }
+    }
+
+    NodeIndex result = NO_NODE;
+    for (NodeIndex factor : factors) {
+        if ((*program)[factor].kind == NodeKind::INTEGER_LITERAL) {
+            continue;
+        }
+        result = (result == NO_NODE) ? factor : binary(result, BinaryOp::MULTIPLY, factor);
+    }
+
+    if (result == NO_NODE) {
+        return literal(constant);
+    }
+    if (constant != 1) {
+        result = binary(result, BinaryOp::MULTIPLY, literal(constant));
+    }
+    return result;
+}
+
+void Optimizer::collectTerms(NodeIndex index, std::vector<Term>& terms) {
+    // The leaves of the chain, left to right, with the sign each one
+    // ends up with: a - (b - c) has terms a, -b, +c
+    pendingTerms.clear();
+    pendingTerms.push_back(Term{index, false});
+    while (!pendingTerms.empty()) {
+        Term term = pendingTerms.back();
+        pendingTerms.pop_back();
+        const Node& node = (*program)[term.node];
+        if (node.kind == NodeKind::BINARY_EXPRESSION && isSumOp(node.op)) {
+            bool rightNegative = (node.op == BinaryOp::SUBTRACT) ? !term.negative : term.negative;
+            pendingTerms.push_back(Term{node.right, rightNegative});
+            pendingTerms.push_back(Term{node.left, term.negative});
+        } else {
+            terms.push_back(term);
+        }
+    }
+}
+
+void Optimizer::collectFactors(NodeIndex index, std::vector<NodeIndex>& factors) {
+    pending.clear();
+    pending.push_back(index);
+    while (!pending.empty()) {
+        NodeIndex factor = pending.back();
+        pending.pop_back();
+        const Node& node = (*program)[factor];
+        if (node.kind == NodeKind::BINARY_EXPRESSION && node.op == BinaryOp::MULTIPLY) {
+            pending.push_back(node.right);
+            pending.push_back(node.left);
+        } else {
+            factors.push_back(factor);
+        }
+    }
+}
+
+bool Optimizer::isLiteral(NodeIndex index, int32_t value) {
+    const Node& node = (*program)[index];
+    return node.kind == NodeKind::INTEGER_LITERAL && node.value == value;
+}
+
+bool Optimizer::isPure(NodeIndex index) {
+    // Pure: no input is read and no division can fail
+    pending.clear();
+    pending.push_back(index);
+    while (!pending.empty()) {
+        const Node& node = (*program)[pending.back()];
+        pending.pop_back();
+        switch (node.kind) {
+            case NodeKind::INTEGER_LITERAL:
+            case NodeKind::VARIABLE_REFERENCE:
+                break;
+            case NodeKind::BINARY_EXPRESSION:
+                if (node.op == BinaryOp::DIVIDE) {
+                    const Node& divisor = (*program)[node.right];
+                    if (divisor.kind != NodeKind::INTEGER_LITERAL || divisor.value == 0 || divisor.value == -1) {
+                        return false;
+                    }
+                }
+                pending.push_back(node.left);
+                pending.push_back(node.right);
+                break;
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+bool Optimizer::sameExpression(NodeIndex a, NodeIndex b) {
+    // Compares the two trees pair by pair
+    pending.clear();
+    pending.push_back(a);
+    pending.push_back(b);
+    while (!pending.empty()) {
+        const Node& y = (*program)[pending.back()];
+        pending.pop_back();
+        const Node& x = (*program)[pending.back()];
+        pending.pop_back();
+        if (x.kind != y.kind) {
+            return false;
+        }
+        switch (x.kind) {
+            case NodeKind::INTEGER_LITERAL:
+                if (x.value != y.value) return false;
+                break;
+            case NodeKind::VARIABLE_REFERENCE:
+                if (x.slot != y.slot) return false;
+                break;
+            case NodeKind::BINARY_EXPRESSION:
+                if (x.op != y.op) return false;
+                pending.push_back(x.left);
+                pending.push_back(y.left);
+                pending.push_back(x.right);
+                pending.push_back(y.right);
+                break;
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+NodeIndex Optimizer::literal(int32_t value) {
+    return program->add(Node::integerLiteral(value), location);
+}
+
+NodeIndex Optimizer::binary(NodeIndex left, BinaryOp op, NodeIndex right) {
+    return program->add(Node::binaryExpression(left, op, right), location);
+}
+
+size_t Optimizer::countNodes(NodeIndex index) {
+    size_t count = 0;
+    walker.postOrder(program->nodes.data(), index, [&](NodeIndex) { count++; });
+    return count;
+}
@@ -0,0 +1,84 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include <vector>
+#include "AST.h"
+
+/**
+ * Optimizer (Constant Folding and Algebraic Simplification)
+ *
+ * Purpose: Shrinks the AST before it runs, so engines do not recompute
+ * values that are already known when the program is parsed.
+ *
+ * How it works (bottom-up, on every expression):
+ * 1. Folds operators whose operands are both literals: (10 + 5) * 2 -> 30
+ * 2. Applies identities: x + 0, x - 0, x * 1, x / 1 -> x;
+ *    x * 0 and x - x -> 0 when x has no side effects
+ * 3. Gathers chains of + and - (or of *) and combines all their
+ *    constants into one: (x + 1) + 2 -> x + 3, 10 - x - 3 -> 7 - x.
+ *    Each chain is gathered once, from its top as it is after steps 1
+ *    and 2, so this stays linear in the size of the expression.
+ * 4. Copies the surviving nodes into a fresh arena
+ *
+ * Every walk over the tree keeps its own stack on the heap rather than
+ * recursing, so expressions nested to any depth are optimized.
+ *
+ * Semantics are preserved:
+ * - Arithmetic wraps around like the engines' 32-bit ints do
+ * - A division by a zero literal is left in place, so "Division by zero"
+ *   is still reported when (and only if) the program reaches it
+ * - inputInt() calls and divisions that might fail are never dropped,
+ *   and non-constant operands keep their evaluation order
+ *
+ * Run it after the Resolver: x - x compares variables by slot.
+ */
+class Optimizer {
+private:
+    ProgramNode* program;
+    SourceLocation location;    // Given to the nodes that simplify() creates
+
+    struct Term {
+        NodeIndex node;
+        bool negative;  // Subtracted rather than added (sums only)
+    };
+
+    // A node waiting for its operands to be optimized
+    struct Frame {
+        NodeIndex index;
+        bool expanded;  // Operands already pushed
+    };
+
+    // Scratch stacks, reused by every walk
+    std::vector<Frame> frames;
+    std::vector<NodeIndex> results;
+    std::vector<Term> pendingTerms;
+    std::vector<NodeIndex> pending;
+    TreeWalker walker;
+
+    // Helper methods
+    NodeIndex optimizeExpression(NodeIndex index);
+    NodeIndex simplify(NodeIndex index);
+    bool endChains(NodeIndex index);
+    NodeIndex reassociate(NodeIndex index);
+    NodeIndex reassociateSum(NodeIndex index);
+    NodeIndex reassociateProduct(NodeIndex index);
+    void collectTerms(NodeIndex index, std::vector<Term>& terms);
+    void collectFactors(NodeIndex index, std::vector<NodeIndex>& factors);
+    bool isLiteral(NodeIndex index, int32_t value);
+    bool isPure(NodeIndex index);
+    bool sameExpression(NodeIndex a, NodeIndex b);
+    NodeIndex literal(int32_t value);
+    NodeIndex binary(NodeIndex left, BinaryOp op, NodeIndex right);
+    size_t countNodes(NodeIndex index);
+
+public:
+    Optimizer();
+
+    /**
+     * Optimizes every statement of a resolved program in place.
+     * Returns how many nodes were removed from the tree.
+     */
+    size_t optimize(ProgramNode* program);
+};
+
+#endif // OPTIMIZER_H
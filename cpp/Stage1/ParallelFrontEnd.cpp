@@ -0,0 +1,188 @@
+#include "ParallelFrontEnd.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "ScanKernels.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+// Chunks per thread, so threads that finish early can take another one
+static const size_t CHUNKS_PER_THREAD = 4;
+
+// lastBreak of a chunk without line breaks
+static const size_t NO_BREAK = SIZE_MAX;
+
+ParallelFrontEnd::ParallelFrontEnd(unsigned threads, size_t chunkBytes)
+    : threads(threads), chunkBytes(std::max<size_t>(chunkBytes, 1)), tokens(0) {
+    if (this->threads == 0) {
+        this->threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+std::unique_ptr<ProgramNode> ParallelFrontEnd::parse(std::string_view source) {
+    split(source);
+    locate(source);
+    forEachChunk([&](Chunk& chunk) { parseChunk(source, chunk); });
+    rethrowFirstError();
+
+    tokens = 1;
+    for (const Chunk& chunk : chunks) {
+        tokens += chunk.tokens;
+    }
+    return merge();
+}
+
+void ParallelFrontEnd::split(std::string_view source) {
+    chunks.clear();
+    size_t size = source.size();
+    size_t target = threads == 1 ? size : std::max(chunkBytes, size / (threads * CHUNKS_PER_THREAD) + 1);
+
+    size_t start = 0;
+    do {
+        size_t end = size;
+        if (size - start > target) {
+            // Cut just after the first ';' past the target size
+            const void* semicolon = std::memchr(source.data() + start + target, ';', size - start - target);
+            if (semicolon != nullptr) {
+                end = static_cast<const char*>(semicolon) - source.data() + 1;
+            }
+        }
+        Chunk chunk{};
+        chunk.start = start;
+        chunk.end = end;
+        chunks.push_back(std::move(chunk));
+        start = end;
+    } while (start < size);
+}
+
+void ParallelFrontEnd::locate(std::string_view source) {
+    // Count line breaks as the Lexer does: "\r\n", "\r" and "\n" are one
+    // each. A chunk starts just after a ';', so no "\r\n" is split.
+    const ScanKernels& scan = selectScanKernels();
+    forEachChunk([&](Chunk& chunk) {
+        const char* lastBreak = nullptr;
+        chunk.lineBreaks = static_cast<uint32_t>(
+            scan.countLineBreaks(source.data() + chunk.start, source.data() + chunk.end, &lastBreak));
+        chunk.lastBreak = lastBreak != nullptr ? static_cast<size_t>(lastBreak - source.data()) : NO_BREAK;
+    });
+
+    uint32_t line = 1;
+    size_t lineStart = 0;
+    for (Chunk& chunk : chunks) {
+        chunk.line = line;
+        chunk.column = static_cast<uint32_t>(chunk.start - lineStart + 1);
+        line += chunk.lineBreaks;
+        if (chunk.lastBreak != NO_BREAK) {
+            lineStart = chunk.lastBreak + 1;
+        }
+    }
+}
+
+void ParallelFrontEnd::parseChunk(std::string_view source, Chunk& chunk) {
+    TokenBuffer buffer;
+    try {
+        Lexer lexer(source.substr(0, chunk.end), chunk.start, chunk.line, chunk.column);
+        buffer = lexer.tokenize();
+    } catch (...) {
+        chunk.lexError = std::current_exception();
+        return;
+    }
+    chunk.tokens = buffer.size() - 1;
+
+    try {
+        Parser parser(buffer);
+        chunk.program = parser.parse();
+    } catch (...) {
+        chunk.parseError = std::current_exception();
+    }
+}
+
+void ParallelFrontEnd::rethrowFirstError() {
+    // A source too large fails before anything is parsed
+    for (const Chunk& chunk : chunks) {
+        if (chunk.lexError) {
+            std::rethrow_exception(chunk.lexError);
+        }
+    }
+    for (const Chunk& chunk : chunks) {
+        if (chunk.parseError) {
+            std::rethrow_exception(chunk.parseError);
+        }
+    }
+}
+
+std::unique_ptr<ProgramNode> ParallelFrontEnd::merge() {
+    if (chunks.size() == 1) {
+        return std::move(chunks[0].program);
+    }
+    auto merged = std::make_unique<ProgramNode>();
+
+    // Symbols first, in source order: a name's symbol is then the same as
+    // if the whole source had been lexed at once
+    size_t nodeCount = 0;
+    size_t statementCount = 0;
+    for (Chunk& chunk : chunks) {
+        const Interner& symbols = chunk.program->symbols;
+        chunk.symbols.resize(symbols.size());
+        for (uint32_t symbol = 0; symbol < symbols.size(); symbol++) {
+            chunk.symbols[symbol] = merged->symbols.intern(symbols.name(symbol));
+        }
+        chunk.base = nodeCount;
+        nodeCount += chunk.program->nodes.size();
+        statementCount += chunk.program->statements.size();
+    }
+
+    merged->nodes.resize(nodeCount);
+    merged->locations.resize(nodeCount);
+    merged->statements.reserve(statementCount);
+    for (const Chunk& chunk : chunks) {
+        for (NodeIndex statement : chunk.program->statements) {
+            merged->statements.push_back(static_cast<NodeIndex>(statement + chunk.base));
+        }
+    }
+
+    forEachChunk([&](Chunk& chunk) {
+        const ProgramNode& program = *chunk.program;
+        NodeIndex base = static_cast<NodeIndex>(chunk.base);
+        for (size_t i = 0; i < program.nodes.size(); i++) {
+            Node node = program.nodes[i];
+            if (node.left != NO_NODE) node.left += base;
+            if (node.right != NO_NODE) node.right += base;
+            if (node.kind == NodeKind::VAR_DECLARATION || node.kind == NodeKind::ASSIGNMENT
+                || node.kind == NodeKind::VARIABLE_REFERENCE) {
+                node.name = chunk.symbols[node.name];
+            }
+            merged->nodes[base + i] = node;
+        }
+        std::copy(program.locations.begin(), program.locations.end(), merged->locations.begin() + base);
+        chunk.program.reset();
+    });
+    return merged;
+}
+
+void ParallelFrontEnd::forEachChunk(const std::function<void(Chunk&)>& work) {
+    size_t workers = std::min<size_t>(threads, chunks.size());
+    if (workers <= 1) {
+        for (Chunk& chunk : chunks) {
+            work(chunk);
+        }
+        return;
+    }
+
+    // Each thread takes the next chunk nobody has started
+    std::atomic<size_t> next{0};
+    auto worker = [&] {
+        for (size_t i = next++; i < chunks.size(); i = next++) {
+            work(chunks[i]);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < workers; i++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+}
@@ -0,0 +1,104 @@
+#ifndef PARALLEL_FRONT_END_H
+#define PARALLEL_FRONT_END_H
+
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "AST.h"
+
+/**
+ * ParallelFrontEnd - Lexes and parses a large source on several threads.
+ *
+ * Purpose: Spreads the front end of very large generated scripts over
+ * every core ("--threads"), producing exactly the tree, and exactly the
+ * errors, that Lexer::tokenize and Parser::parse produce on one.
+ *
+ * How it works:
+ * A MidLang program is a flat list of statements, and a ';' can only
+ * ever end one (the language has no strings or comments), so the text
+ * right after any ';' is a safe place to cut it.
+ * 1. The source is cut into chunks of roughly equal size, each ending
+ *    just after a ';'; there are a few more chunks than threads, so a
+ *    slow chunk does not leave the other threads idle
+ * 2. The line breaks of every chunk are counted in parallel, and a
+ *    running total gives the line and column each chunk starts at, so
+ *    locations and error messages are the same as for one lexer
+ * 3. Each chunk is lexed and parsed into its own ProgramNode, in parallel
+ * 4. The chunks' symbols are merged in source order, which numbers every
+ *    name as a single pass would, and then every chunk's nodes are copied
+ *    into one arena in parallel, with their child indexes moved past the
+ *    chunks before it and their names renumbered
+ *
+ * Errors: the first chunk whose parse failed wins, which is the first
+ * error in source order. The lexer leaves every error in the source to
+ * the parser, even a character it does not recognize (where it stops)
+ * or a literal out of range, so a chunk's parser reports its first one.
+ * The lexer only throws for a source too large to read, which fails the
+ * whole run before any parse error.
+ *
+ * The threads are started for each of the three parallel steps and
+ * joined at its end; a chunk is far more work than starting a thread.
+ */
+class ParallelFrontEnd {
+private:
+    struct Chunk {
+        size_t start;               // Byte range of the chunk
+        size_t end;
+        uint32_t lineBreaks;        // Line breaks in the chunk
+        size_t lastBreak;           // Position of the last one, if any
+        uint32_t line;              // Where the chunk starts
+        uint32_t column;
+        size_t tokens;              // Tokens lexed, EOF not counted
+        std::exception_ptr lexError;
+        std::exception_ptr parseError;
+        std::unique_ptr<ProgramNode> program;
+        std::vector<uint32_t> symbols;  // Chunk symbol -> merged symbol
+        size_t base;                // Index of the chunk's first node in the merged arena
+    };
+
+    unsigned threads;
+    size_t chunkBytes;
+    std::vector<Chunk> chunks;
+    size_t tokens;
+
+    void split(std::string_view source);
+    void locate(std::string_view source);
+    void parseChunk(std::string_view source, Chunk& chunk);
+    void rethrowFirstError();
+    std::unique_ptr<ProgramNode> merge();
+    void forEachChunk(const std::function<void(Chunk&)>& work);
+
+public:
+    // Smallest chunk worth a thread of its own
+    static const size_t DEFAULT_CHUNK_BYTES = 1 << 20;
+
+    /**
+     * threads is the number of threads to use (0 for one per core);
+     * chunks are at least chunkBytes long, so small sources are read in
+     * one piece.
+     */
+    ParallelFrontEnd(unsigned threads, size_t chunkBytes = DEFAULT_CHUNK_BYTES);
+
+    /**
+     * Lexes and parses source. Throws LexError or ParseError like the
+     * Lexer and Parser do.
+     */
+    std::unique_ptr<ProgramNode> parse(std::string_view source);
+
+    /**
+     * Number of chunks and of tokens in the last parse() (the EOF token
+     * counted once, as the Lexer counts it).
+     */
+    size_t chunkCount() const { return chunks.size(); }
+    size_t tokenCount() const { return tokens; }
+
+    /**
+     * Number of threads in use.
+     */
+    unsigned threadCount() const { return threads; }
+};
+
+#endif // PARALLEL_FRONT_END_H
@@ -1,21 +1,47 @@
 #include "Parser.h"
-#include <stdexcept>
+#include "Errors.h"
 #include <sstream>
 
-Parser::Parser(const std::vector<Token>& tokens)
-    : tokens(tokens), current(0) {}
+Parser::Parser(const TokenBuffer& tokens)
+    : tokens(tokens), current(0), program(nullptr) {}
 
 std::unique_ptr<ProgramNode> Parser::parse() {
-    std::vector<std::unique_ptr<Statement>> statements;
+    auto result = std::make_unique<ProgramNode>();
+    program = result.get();
+    current = 0;
+
+    // Every node consumes at least one token, so this single reservation
+    // is enough for the whole tree and the arena never has to grow.
+    program->nodes.reserve(tokens.size());
+    program->locations.reserve(tokens.size());
+    program->symbols = tokens.symbols;
 
     while (!isAtEnd()) {
-        statements.push_back(parseStatement());
+        program->statements.push_back(parseStatement());
     }
 
-    return std::make_unique<ProgramNode>(std::move(statements));
+    program = nullptr;
+    return result;
 }
 
-std::unique_ptr<Statement> Parser::parseStatement() {
+NodeIndex Parser::parseSingleStatement(ProgramNode& target) {
+    program = &target;
+    current = 0;
+
+    // The program has every symbol of earlier fills of the buffer; add
+    // the ones this statement introduced, so both number names alike
+    for (size_t symbol = program->symbols.size(); symbol < tokens.symbols.size(); symbol++) {
+        program->symbols.intern(tokens.symbols.name(static_cast<uint32_t>(symbol)));
+    }
+
+    NodeIndex statement = parseStatement();
+    program->statements.push_back(statement);
+
+    program = nullptr;
+    return statement;
+}
+
+NodeIndex Parser::parseStatement() {
     if (match(TokenType::VAR)) {
         return parseVarDeclaration();
     } else if (match(TokenType::PRINT)) {
@@ -25,83 +51,138 @@ std::unique_ptr<Statement> Parser::parseStatement() {
     }
 }
 
-std::unique_ptr<VarDeclarationStatement> Parser::parseVarDeclaration() {
-    Token identifier = consume(TokenType::IDENTIFIER, "Expected variable name after 'var'");
+NodeIndex Parser::parseVarDeclaration() {
+    SourceLocation location = locationOf(previous());
+    size_t identifier = consume(TokenType::IDENTIFIER, "Expected variable name after 'var'");
     consume(TokenType::ASSIGN, "Expected '=' after variable name");
     auto expression = parseExpression();
     consume(TokenType::SEMICOLON, "Expected ';' after expression");
 
-    return std::make_unique<VarDeclarationStatement>(identifier.value, std::move(expression));
+    uint32_t name = static_cast<uint32_t>(tokens.values[identifier]);
+    return program->add(Node::statement(NodeKind::VAR_DECLARATION, expression, name), location);
 }
 
-std::unique_ptr<AssignmentStatement> Parser::parseAssignmentStatement() {
-    Token identifier = consume(TokenType::IDENTIFIER, "Expected variable name");
+NodeIndex Parser::parseAssignmentStatement() {
+    size_t identifier = consume(TokenType::IDENTIFIER, "Expected variable name");
     consume(TokenType::ASSIGN, "Expected '=' after variable name");
     auto expression = parseExpression();
     consume(TokenType::SEMICOLON, "Expected ';' after expression");
 
-    return std::make_unique<AssignmentStatement>(identifier.value, std::move(expression));
+    uint32_t name = static_cast<uint32_t>(tokens.values[identifier]);
+    return program->add(Node::statement(NodeKind::ASSIGNMENT, expression, name), locationOf(identifier));
 }
 
-std::unique_ptr<PrintStatement> Parser::parsePrintStatement() {
+NodeIndex Parser::parsePrintStatement() {
+    SourceLocation location = locationOf(previous());
     consume(TokenType::LEFT_PAREN, "Expected '(' after 'print'");
     auto expression = parseExpression();
     consume(TokenType::RIGHT_PAREN, "Expected ')' after expression");
     consume(TokenType::SEMICOLON, "Expected ';' after ')'");
 
-    return std::make_unique<PrintStatement>(std::move(expression));
+    return program->add(Node::statement(NodeKind::PRINT, expression), location);
 }
 
-std::unique_ptr<Expression> Parser::parseExpression() {
-    auto expr = parseTerm();
-
-    while (match(TokenType::PLUS) || match(TokenType::MINUS)) {
-        std::string op = previous().value;
-        auto right = parseTerm();
-        expr = std::make_unique<BinaryExpression>(std::move(expr), op, std::move(right));
+// The operator an operator token stands for
+static BinaryOp operatorOf(TokenType type) {
+    switch (type) {
+        case TokenType::PLUS: return BinaryOp::ADD;
+        case TokenType::MINUS: return BinaryOp::SUBTRACT;
+        case TokenType::MULTIPLY: return BinaryOp::MULTIPLY;
+        default: return BinaryOp::DIVIDE;
     }
-
-    return expr;
 }
 
-std::unique_ptr<Expression> Parser::parseTerm() {
-    auto expr = parseFactor();
-
-    while (match(TokenType::MULTIPLY) || match(TokenType::DIVIDE)) {
-        std::string op = previous().value;
-        auto right = parseFactor();
-        expr = std::make_unique<BinaryExpression>(std::move(expr), op, std::move(right));
+NodeIndex Parser::parseExpression() {
+    // Expression = Term { ("+" | "-") Term }, Term = Factor { ("*" | "/") Factor },
+    // Factor = operand | "(" Expression ")", without a call per level:
+    // an operator waits on the stack until one of lower or equal
+    // precedence (or a closing parenthesis, or the end) shows that its
+    // right operand is complete. Nodes are created in the same order as
+    // the recursive grammar would create them.
+    if (operators.empty()) {
+        operators.resize(64);
+    }
+    PendingOperator* stack = operators.data();
+    size_t top = 0;
+    stack[0] = PendingOperator{0, NO_NODE, BinaryOp{}, -1};
+    auto push = [&](const PendingOperator& pending) {
+        // Grow the storage when the stack reaches its end
+        if (++top == operators.size()) {
+            operators.resize(operators.size() * 2);
+            stack = operators.data();
+        }
+        stack[top] = pending;
+    };
+
+    while (true) {
+        // Factor: any number of open parentheses, then an operand
+        while (match(TokenType::LEFT_PAREN)) {
+            push(PendingOperator{static_cast<uint32_t>(previous()), NO_NODE, BinaryOp{}, 0});
+        }
+        NodeIndex value = parseOperand();
+
+        // Close parentheses until an operator follows
+        while (true) {
+            TokenType type = peek();
+            int8_t precedence = (type == TokenType::PLUS || type == TokenType::MINUS) ? 1
+                              : (type == TokenType::MULTIPLY || type == TokenType::DIVIDE) ? 2 : 0;
+            if (precedence == 0) {
+                // The innermost open expression ends here
+                while (stack[top].precedence > 0) {
+                    value = reduce(stack[top--], value);
+                }
+                if (stack[top].precedence < 0) {
+                    return value;
+                }
+                consume(TokenType::RIGHT_PAREN, "Expected ')' after expression");
+                top--;
+                continue;
+            }
+
+            while (stack[top].precedence >= precedence) {
+                value = reduce(stack[top--], value);
+            }
+            push(PendingOperator{static_cast<uint32_t>(advance()), value, operatorOf(type), precedence});
+            break;
+        }
     }
+}
 
-    return expr;
+NodeIndex Parser::reduce(const PendingOperator& pending, NodeIndex right) {
+    // The operator has both operands now
+    return program->add(Node::binaryExpression(pending.left, pending.op, right), locationOf(pending.token));
 }
 
-std::unique_ptr<Expression> Parser::parseFactor() {
+NodeIndex Parser::parseOperand() {
     if (match(TokenType::INTEGER)) {
-        int value = std::stoi(previous().value);
-        return std::make_unique<IntegerLiteral>(value);
+        size_t literal = previous();
+        int value = tokens.values[literal];
+        if (value == TokenBuffer::OUT_OF_RANGE) {
+            std::stringstream ss;
+            ss << "Integer literal out of range: " << tokens.text(literal)
+               << " at line " << tokens.lines[literal] << ", column " << tokens.columns[literal];
+            throw LexError(ss.str());
+        }
+        return program->add(Node::integerLiteral(value), locationOf(literal));
     }
 
     if (match(TokenType::INPUT_INT)) {
+        SourceLocation location = locationOf(previous());
         consume(TokenType::LEFT_PAREN, "Expected '(' after 'inputInt'");
         consume(TokenType::RIGHT_PAREN, "Expected ')' after '('");
-        return std::make_unique<InputIntExpression>();
+        return program->add(Node::inputInt(), location);
     }
 
     if (match(TokenType::IDENTIFIER)) {
-        return std::make_unique<VariableReference>(previous().value);
-    }
-
-    if (match(TokenType::LEFT_PAREN)) {
-        auto expr = parseExpression();
-        consume(TokenType::RIGHT_PAREN, "Expected ')' after expression");
-        return expr;
+        size_t identifier = previous();
+        uint32_t name = static_cast<uint32_t>(tokens.values[identifier]);
+        return program->add(Node::variableReference(name), locationOf(identifier));
     }
 
     std::stringstream ss;
-    ss << "Unexpected token: " << static_cast<int>(peek().type)
-       << " at line " << peek().line << ", column " << peek().column;
-    throw std::runtime_error(ss.str());
+    ss << "Unexpected token: " << static_cast<int>(peek())
+       << " at line " << tokens.lines[current] << ", column " << tokens.columns[current];
+    fail(ss.str());
 }
 
 bool Parser::match(TokenType type) {
@@ -118,33 +199,44 @@ bool Parser::match(TokenType type1, TokenType type2) {
 
 bool Parser::check(TokenType type) {
     if (isAtEnd()) return false;
-    return peek().type == type;
+    return peek() == type;
 }
 
-Token Parser::advance() {
+size_t Parser::advance() {
     if (!isAtEnd()) current++;
     return previous();
 }
 
 bool Parser::isAtEnd() {
-    return peek().type == TokenType::EOF_TOKEN;
+    return peek() == TokenType::EOF_TOKEN;
 }
 
-Token Parser::peek() {
-    return tokens[current];
+TokenType Parser::peek() {
+    return tokens.types[current];
 }
 
-Token Parser::previous() {
-    return tokens[current - 1];
+size_t Parser::previous() {
+    return current - 1;
 }
 
-Token Parser::consume(TokenType type, const std::string& message) {
+SourceLocation Parser::locationOf(size_t token) {
+    return SourceLocation{tokens.lines[token], tokens.columns[token]};
+}
+
+size_t Parser::consume(TokenType type, const char* message) {
     if (check(type)) return advance();
 
-    Token token = peek();
     std::stringstream ss;
-    ss << message << " at line " << token.line << ", column " << token.column
-       << ". Found: " << static_cast<int>(token.type);
-    throw std::runtime_error(ss.str());
+    ss << message << " at line " << tokens.lines[current] << ", column " << tokens.columns[current]
+       << ". Found: " << static_cast<int>(peek());
+    fail(ss.str());
 }
 
+void Parser::fail(const std::string& message) {
+    // The lexer stops at a character it does not recognize, so the parser
+    // is the first to reach it. Report that as a lexical error.
+    if (peek() == TokenType::UNKNOWN) {
+        throw LexError(message);
+    }
+    throw ParseError(message);
+}
@@ -1,8 +1,9 @@
 #ifndef PARSER_H
 #define PARSER_H
 
-#include <vector>
 #include <memory>
+#include <string>
+#include <vector>
 #include "Token.h"
 #include "AST.h"
 
@@ -12,10 +13,15 @@
  * Purpose: Builds an Abstract Syntax Tree (AST) from tokens.
  * 
  * How it works:
- * 1. Takes a list of tokens from the lexer
- * 2. Uses recursive descent parsing
+ * 1. Reads the token buffer from the lexer in place (no copies)
+ * 2. Uses recursive descent parsing for statements, and operator
+ *    precedence parsing for expressions: operators and open parentheses
+ *    wait on explicit stacks instead of in nested calls, so expressions
+ *    can nest to any depth. The tree is the same one the grammar below
+ *    describes, with operators of equal precedence grouping to the left.
  * 3. Verifies syntax matches the grammar
- * 4. Builds AST nodes representing the program structure
+ * 4. Builds AST nodes representing the program structure, appending
+ *    them to the program's node arena
  * 
  * Grammar (recall from EBNF):
  * Program = Statement { Statement }
@@ -28,35 +34,62 @@
  */
 class Parser {
 private:
-    std::vector<Token> tokens;
-    size_t current;
+    const TokenBuffer& tokens;  // Not owned: must outlive the Parser
+    size_t current;             // Index of the next token
+    ProgramNode* program;       // Program being built
+
+    // An operator, or an open parenthesis (precedence 0), still waiting
+    // for its right operand. The bottom of the stack is a marker with
+    // precedence -1.
+    struct PendingOperator {
+        uint32_t token;
+        NodeIndex left;     // Its left operand
+        BinaryOp op;
+        int8_t precedence;
+    };
+    // Storage for the operator stack, kept between expressions.
+    // parseExpression tracks the top in a local, so adding a node does
+    // not make the compiler reload the stack from memory.
+    std::vector<PendingOperator> operators;
 
     // Helper methods
     bool match(TokenType type);
     bool match(TokenType type1, TokenType type2);
     bool check(TokenType type);
-    Token advance();
+    size_t advance();
     bool isAtEnd();
-    Token peek();
-    Token previous();
-    Token consume(TokenType type, const std::string& message);
+    TokenType peek();
+    size_t previous();
+    size_t consume(TokenType type, const char* message);
+    SourceLocation locationOf(size_t token);
+    [[noreturn]] void fail(const std::string& message);
 
     // Parsing methods
-    std::unique_ptr<Statement> parseStatement();
-    std::unique_ptr<VarDeclarationStatement> parseVarDeclaration();
-    std::unique_ptr<AssignmentStatement> parseAssignmentStatement();
-    std::unique_ptr<PrintStatement> parsePrintStatement();
-    std::unique_ptr<Expression> parseExpression();
-    std::unique_ptr<Expression> parseTerm();
-    std::unique_ptr<Expression> parseFactor();
+    NodeIndex parseStatement();
+    NodeIndex parseVarDeclaration();
+    NodeIndex parseAssignmentStatement();
+    NodeIndex parsePrintStatement();
+    NodeIndex parseExpression();
+    NodeIndex parseOperand();
+    NodeIndex reduce(const PendingOperator& pending, NodeIndex right);
 
 public:
-    Parser(const std::vector<Token>& tokens);
+    Parser(const TokenBuffer& tokens);
     
     /**
-     * Parses the token stream and returns a Program AST node.
+     * Parses the token stream and returns a Program AST node, which
+     * gets a copy of the buffer's symbols.
      */
     std::unique_ptr<ProgramNode> parse();
+
+    /**
+     * Parses the single statement held in the token buffer (as produced
+     * by Lexer::tokenizeStatement) and appends its nodes to program.
+     * Used for streaming execution, where the buffer is refilled for
+     * every statement. program must be new or only ever have been
+     * filled from this buffer, so that both share the same symbols.
+     */
+    NodeIndex parseSingleStatement(ProgramNode& program);
 };
 
 #endif // PARSER_H
@@ -0,0 +1,99 @@
+#include "Profile.h"
+#include <iomanip>
+
+static const char* kindName(NodeKind kind) {
+    switch (kind) {
+        case NodeKind::VAR_DECLARATION: return "var";
+        case NodeKind::ASSIGNMENT: return "assign";
+        case NodeKind::PRINT: return "print";
+        case NodeKind::INTEGER_LITERAL: return "literal";
+        case NodeKind::VARIABLE_REFERENCE: return "variable";
+        case NodeKind::BINARY_EXPRESSION: return "binary";
+        case NodeKind::INPUT_INT: return "inputInt";
+        default: return "unknown";
+    }
+}
+
+static double seconds(int64_t nanoseconds) {
+    return static_cast<double>(nanoseconds) / 1e9;
+}
+
+void Profile::reset(const ProgramNode& program) {
+    statements.assign(program.statements.size(), StatementProfile{0, 0, 0});
+    nodeHits.assign(program.nodes.size(), 0);
+}
+
+void Profile::writeJson(std::ostream& out, const ProgramNode& program, const std::string& sourceName) const {
+    int64_t total = 0;
+    int64_t totalInput = 0;
+    for (const StatementProfile& entry : statements) {
+        total += entry.nanoseconds;
+        totalInput += entry.inputNanoseconds;
+    }
+
+    out << std::setprecision(9);
+    out << "{\n";
+    out << "  \"schema\": 1,\n";
+    out << "  \"source\": \"";
+    for (char c : sourceName) {
+        if (c == '"' || c == '\\') out << '\\';
+        out << c;
+    }
+    out << "\",\n";
+    out << "  \"total_seconds\": " << seconds(total) << ",\n";
+    out << "  \"input_wait_seconds\": " << seconds(totalInput) << ",\n";
+
+    out << "  \"statements\": [\n";
+    for (size_t i = 0; i < statements.size(); i++) {
+        NodeIndex index = program.statements[i];
+        const SourceLocation& location = program.locations[index];
+        const StatementProfile& entry = statements[i];
+        out << "    {\"line\": " << location.line << ", \"column\": " << location.column
+            << ", \"kind\": \"" << kindName(program[index].kind) << "\""
+            << ", \"count\": " << entry.count
+            << ", \"seconds\": " << seconds(entry.nanoseconds)
+            << ", \"input_wait_seconds\": " << seconds(entry.inputNanoseconds) << "}"
+            << (i + 1 < statements.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n";
+
+    // Only nodes that ran; folded-away nodes are no longer in the program
+    out << "  \"nodes\": [";
+    bool first = true;
+    for (size_t i = 0; i < nodeHits.size(); i++) {
+        if (nodeHits[i] == 0) {
+            continue;
+        }
+        const Node& node = program.nodes[i];
+        const SourceLocation& location = program.locations[i];
+        out << (first ? "\n" : ",\n");
+        out << "    {\"line\": " << location.line << ", \"column\": " << location.column
+            << ", \"kind\": \"" << kindName(node.kind) << "\"";
+        if (node.kind == NodeKind::BINARY_EXPRESSION) {
+            out << ", \"op\": \"" << symbolOf(node.op) << "\"";
+        }
+        out << ", \"count\": " << nodeHits[i] << "}";
+        first = false;
+    }
+    out << (first ? "]\n" : "\n  ]\n");
+    out << "}\n";
+}
+
+void Profile::writeFolded(std::ostream& out, const ProgramNode& program) const {
+    for (size_t i = 0; i < statements.size(); i++) {
+        const StatementProfile& entry = statements[i];
+        if (entry.count == 0) {
+            continue;
+        }
+        NodeIndex index = program.statements[i];
+        const SourceLocation& location = program.locations[index];
+        std::string frame = std::string("program;") + kindName(program[index].kind) + "@"
+                            + std::to_string(location.line) + ":" + std::to_string(location.column);
+
+        // Self time of the statement, then its inputInt() waits as a child frame
+        out << frame << " " << (entry.nanoseconds - entry.inputNanoseconds) << "\n";
+        if (entry.inputNanoseconds > 0) {
+            out << frame << ";inputInt " << entry.inputNanoseconds << "\n";
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "AST.h"
+
+/**
+ * StatementProfile - What one top-level statement cost while it ran.
+ */
+struct StatementProfile {
+    uint64_t count;          // Times the statement started running
+    int64_t nanoseconds;     // Total wall time, including inputInt() waits
+    int64_t inputNanoseconds;  // Part of that spent waiting in inputInt()
+};
+
+/**
+ * Profile - Execution counts and times gathered by a profiled run.
+ *
+ * Purpose: Show which statements of a slow program cost the most, by
+ * source line and column, without an external profiler.
+ *
+ * How it works:
+ * 1. The Evaluator fills it in when given one (Evaluator::evaluate with
+ *    a Profile); a run without one records nothing and costs nothing.
+ * 2. "statements" is indexed like ProgramNode::statements, "nodeHits"
+ *    like ProgramNode::nodes, so the program's locations name each entry.
+ * 3. writeJson() writes the full report; writeFolded() writes one line
+ *    per statement in the folded-stack format read by flamegraph tools.
+ */
+class Profile {
+public:
+    std::vector<StatementProfile> statements;
+    std::vector<uint64_t> nodeHits;
+
+    /**
+     * Sizes the counters for a program and sets them all to zero.
+     */
+    void reset(const ProgramNode& program);
+
+    /**
+     * Writes the report as JSON. sourceName is recorded in the report.
+     */
+    void writeJson(std::ostream& out, const ProgramNode& program, const std::string& sourceName) const;
+
+    /**
+     * Writes one "program;<statement> <nanoseconds>" line per statement
+     * that ran, plus a "program;<statement>;inputInt <nanoseconds>" line
+     * for its input waits. The statement frame is its kind and location,
+     * e.g. "print@3:1".
+     */
+    void writeFolded(std::ostream& out, const ProgramNode& program) const;
+};
+
+#endif // PROFILE_H
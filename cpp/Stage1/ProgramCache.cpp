@@ -0,0 +1,215 @@
+#include "ProgramCache.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <vector>
+
+static const char CACHE_MAGIC[4] = {'M', 'I', 'D', 'C'};
+static const uint32_t CACHE_VERSION = 2;
+
+struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t instructionSize;
+    uint64_t sourceHash;
+    uint64_t sourceSize;
+    uint64_t instructionCount;
+    uint64_t slotCount;
+    uint64_t maxStackDepth;
+    uint64_t checksum;
+};
+
+// The file stores instructions exactly as they sit in memory
+static_assert(sizeof(CacheHeader) == 64, "cache header must be 64 bytes");
+static_assert(sizeof(Instruction) == 8 && offsetof(Instruction, operand) == 4,
+              "cache format assumes an 8-byte Instruction");
+
+CachedProgram::CachedProgram() : code(nullptr), slots(0), stackDepth(0) {}
+
+ProgramCache::ProgramCache(const std::string& directory) : directory(directory) {}
+
+uint64_t ProgramCache::hash(const void* data, size_t size, uint64_t value) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+        value ^= bytes[i];
+        value *= 1099511628211ull;
+    }
+    return value;
+}
+
+std::string ProgramCache::pathFor(uint64_t sourceHash, uint32_t passes) const {
+    static const char digits[] = "0123456789abcdef";
+    std::string name(16, '0');
+    for (int i = 15; i >= 0; i--) {
+        name[i] = digits[sourceHash & 0xf];
+        sourceHash >>= 4;
+    }
+    std::string suffix = ".midc";
+    if (passes == OPTIMIZED) {
+        suffix = ".nossa.midc";
+    } else if (passes == 0) {
+        suffix = ".noopt.midc";
+    } else if (passes != (OPTIMIZED | SSA)) {
+        suffix = ".passes" + std::to_string(passes) + ".midc";
+    }
+    return (std::filesystem::path(directory) / (name + suffix)).string();
+}
+
+bool ProgramCache::load(std::string_view source, uint32_t passes, CachedProgram& program) const {
+    uint64_t sourceHash = hash(source.data(), source.size());
+    if (!program.file.open(pathFor(sourceHash, passes))) {
+        return false;
+    }
+    std::string_view contents = program.file.text();
+    if (contents.size() < sizeof(CacheHeader)) {
+        return false;
+    }
+
+    CacheHeader header;
+    std::memcpy(&header, contents.data(), sizeof(header));
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0
+        || header.version != CACHE_VERSION
+        || header.flags != passes
+        || header.instructionSize != sizeof(Instruction)
+        || header.sourceHash != sourceHash
+        || header.sourceSize != source.size()
+        || header.instructionCount == 0
+        || header.instructionCount != (contents.size() - sizeof(header)) / sizeof(Instruction)
+        || (contents.size() - sizeof(header)) % sizeof(Instruction) != 0) {
+        return false;
+    }
+
+    const char* payload = contents.data() + sizeof(header);
+    size_t payloadSize = contents.size() - sizeof(header);
+    if (reinterpret_cast<uintptr_t>(payload) % alignof(Instruction) != 0
+        || checksumOf(header, payload, payloadSize) != header.checksum) {
+        return false;
+    }
+
+    const Instruction* code = reinterpret_cast<const Instruction*>(payload);
+    if (!verify(code, header.instructionCount, header.slotCount, header.maxStackDepth)) {
+        return false;
+    }
+
+    program.code = code;
+    program.slots = header.slotCount;
+    program.stackDepth = header.maxStackDepth;
+    return true;
+}
+
+bool ProgramCache::store(std::string_view source, uint32_t passes, const BytecodeProgram& program) const {
+    // Lay the instructions out byte by byte so padding is always zero
+    // and the checksum does not depend on uninitialized memory. Only the
+    // slots the instructions use are recorded, which load() checks.
+    std::vector<char> payload(program.code.size() * sizeof(Instruction), 0);
+    size_t slotCount = 0;
+    for (size_t i = 0; i < program.code.size(); i++) {
+        const Instruction& instruction = program.code[i];
+        char* out = payload.data() + i * sizeof(Instruction);
+        out[0] = static_cast<char>(instruction.op);
+        std::memcpy(out + offsetof(Instruction, operand), &instruction.operand, sizeof(int32_t));
+        if (instruction.op == OpCode::LOAD_SLOT || instruction.op == OpCode::STORE_SLOT) {
+            slotCount = std::max(slotCount, static_cast<size_t>(instruction.operand) + 1);
+        }
+    }
+
+    CacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.flags = passes;
+    header.instructionSize = sizeof(Instruction);
+    header.sourceHash = hash(source.data(), source.size());
+    header.sourceSize = source.size();
+    header.instructionCount = program.code.size();
+    header.slotCount = slotCount;
+    header.maxStackDepth = program.maxStackDepth;
+    header.checksum = checksumOf(header, payload.data(), payload.size());
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    std::string path = pathFor(header.sourceHash, passes);
+    std::string temporary = path + ".tmp" + std::to_string(std::random_device{}());
+    {
+        std::ofstream out(temporary, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+        if (!out) {
+            out.close();
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+    }
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
+
+uint64_t ProgramCache::checksumOf(const CacheHeader& header, const char* payload, size_t payloadSize) {
+    // The header with the checksum itself left as 0, then the instructions
+    CacheHeader unsummed = header;
+    unsummed.checksum = 0;
+    return hash(payload, payloadSize, hash(&unsummed, sizeof(unsummed)));
+}
+
+bool ProgramCache::verify(const Instruction* code, size_t count, size_t slotCount, size_t maxStackDepth) {
+    // The slot count and the stack depth must be exactly what the code
+    // needs: they size the VM's arrays, so a corrupt header must not
+    // reach it even if the checksum happens to match
+    size_t depth = 0;
+    size_t deepest = 0;
+    size_t usedSlots = 0;
+    for (size_t i = 0; i < count; i++) {
+        const Instruction& instruction = code[i];
+        switch (instruction.op) {
+            case OpCode::PUSH_CONST:
+            case OpCode::INPUT_INT:
+                depth++;
+                break;
+            case OpCode::LOAD_SLOT:
+                if (instruction.operand < 0 || static_cast<size_t>(instruction.operand) >= slotCount) {
+                    return false;
+                }
+                usedSlots = std::max(usedSlots, static_cast<size_t>(instruction.operand) + 1);
+                depth++;
+                break;
+            case OpCode::STORE_SLOT:
+                if (instruction.operand < 0 || static_cast<size_t>(instruction.operand) >= slotCount) {
+                    return false;
+                }
+                usedSlots = std::max(usedSlots, static_cast<size_t>(instruction.operand) + 1);
+                if (depth < 1) return false;
+                depth--;
+                break;
+            case OpCode::PRINT:
+                if (depth < 1) return false;
+                depth--;
+                break;
+            case OpCode::ADD:
+            case OpCode::SUB:
+            case OpCode::MUL:
+            case OpCode::DIV:
+                if (depth < 2) return false;
+                depth--;
+                break;
+            case OpCode::HALT:
+                // Only allowed as the very last instruction
+                return i + 1 == count && usedSlots == slotCount && deepest == maxStackDepth;
+            default:
+                return false;
+        }
+        if (depth > maxStackDepth) {
+            return false;
+        }
+        deepest = std::max(deepest, depth);
+    }
+    return false;
+}
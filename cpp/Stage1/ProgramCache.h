@@ -0,0 +1,105 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "Bytecode.h"
+#include "SourceFile.h"
+
+struct CacheHeader;
+
+/**
+ * CachedProgram - A compiled program loaded from the cache.
+ *
+ * The instructions are used in place, straight from the mapped cache
+ * file; nothing is copied or rebuilt.
+ */
+class CachedProgram {
+private:
+    SourceFile file;             // The mapped .midc file
+    const Instruction* code;
+    size_t slots;
+    size_t stackDepth;
+
+    friend class ProgramCache;
+
+public:
+    CachedProgram();
+
+    const Instruction* instructions() const { return code; }
+    size_t slotCount() const { return slots; }
+    size_t maxStackDepth() const { return stackDepth; }
+};
+
+/**
+ * ProgramCache - A directory of compiled programs (.midc files), so an
+ * unchanged script skips lexing, parsing and compiling on later runs.
+ *
+ * Purpose: Scripts that are run over and over pay for the front end
+ * once. The cache is keyed by a hash of the source text, so editing a
+ * script simply misses the cache and nothing has to be invalidated.
+ *
+ * File format (version 2, native byte order; all fields are checked on
+ * load):
+ *   offset  size  field
+ *   0       4     magic "MIDC"
+ *   4       4     format version
+ *   8       4     flags (bit 0: Optimizer ran, bit 1: SsaOptimizer ran)
+ *   12      4     size of an Instruction (8)
+ *   16      8     FNV-1a hash of the source text
+ *   24      8     source size in bytes
+ *   32      8     instruction count
+ *   40      8     slot count (the highest slot the instructions use, plus 1)
+ *   48      8     maximum stack depth
+ *   56      8     FNV-1a hash of the header (with this field 0) and the
+ *                 instructions (checksum)
+ *   64      ...   instructions, as the VM stores them in memory
+ *
+ * A missing, truncated, corrupt, foreign or stale file is never used:
+ * load() returns false and the caller compiles from source as usual.
+ * Instructions are also checked before they are accepted (valid opcodes,
+ * slots in range, stack never over- or underflows, ends with HALT), and
+ * the slot count and stack depth must be exactly the ones they need, so
+ * the VM can run them without further checks.
+ */
+class ProgramCache {
+private:
+    std::string directory;
+
+    std::string pathFor(uint64_t sourceHash, uint32_t passes) const;
+    static uint64_t checksumOf(const CacheHeader& header, const char* payload, size_t payloadSize);
+    static bool verify(const Instruction* code, size_t count, size_t slotCount, size_t maxStackDepth);
+
+public:
+    // Optimization passes a cached program went through; programs built
+    // with different passes are kept apart
+    static const uint32_t OPTIMIZED = 1;
+    static const uint32_t SSA = 2;
+
+    // Starting value of hash(); passing the result of one call as the
+    // start of the next hashes the two blocks as one
+    static const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+
+    explicit ProgramCache(const std::string& directory);
+
+    /**
+     * Loads the compiled form of source into program. Returns false if
+     * there is no usable entry.
+     */
+    bool load(std::string_view source, uint32_t passes, CachedProgram& program) const;
+
+    /**
+     * Writes the compiled form of source to the cache. The file is
+     * written under a temporary name and renamed into place, so readers
+     * never see half a file. Returns false if it could not be written.
+     */
+    bool store(std::string_view source, uint32_t passes, const BytecodeProgram& program) const;
+
+    /**
+     * 64-bit FNV-1a hash, used for cache keys and checksums.
+     */
+    static uint64_t hash(const void* data, size_t size, uint64_t value = FNV_OFFSET_BASIS);
+};
+
+#endif // PROGRAM_CACHE_H
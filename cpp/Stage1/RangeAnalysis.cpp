@@ -0,0 +1,166 @@
+#include "RangeAnalysis.h"
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+
+// Every value a 32-bit int can have
+static const RangeAnalysis::Interval ANY_INT = {INT32_MIN, INT32_MAX};
+
+// How far apart two wrapped-around results are
+static const int64_t WRAP = static_cast<int64_t>(1) << 32;
+
+// Which multiple of WRAP a 64-bit result must be moved by to fit an int
+static int64_t wraps(int64_t value) {
+    int64_t offset = value - INT32_MIN;
+    return (offset >= 0 ? offset : offset - (WRAP - 1)) / WRAP;
+}
+
+static bool contains(const RangeAnalysis::Interval& range, int64_t value) {
+    return range.low <= value && value <= range.high;
+}
+
+RangeAnalysis::Stats RangeAnalysis::analyze(ProgramNode* program) {
+    this->program = program;
+    ranges.assign(program->nodes.size(), ANY_INT);
+    slotRanges.assign(program->slotNames.size(), ANY_INT);
+    found.clear();
+    stats = Stats{0, 0};
+
+    for (NodeIndex index : program->statements) {
+        const Node& statement = (*program)[index];
+        analyzeExpression(statement.left);
+        if (statement.kind == NodeKind::VAR_DECLARATION || statement.kind == NodeKind::ASSIGNMENT) {
+            slotRanges[statement.slot] = ranges[statement.left];
+        }
+    }
+
+    return stats;
+}
+
+void RangeAnalysis::analyzeExpression(NodeIndex expression) {
+    // Operands come before their operator, as the engines evaluate them,
+    // so diagnostics come out in the order the checks would fail
+    walker.postOrder(program->nodes.data(), expression, [&](NodeIndex index) {
+        const Node& node = (*program)[index];
+        switch (node.kind) {
+            case NodeKind::INTEGER_LITERAL:
+                ranges[index] = Interval{node.value, node.value};
+                break;
+            case NodeKind::VARIABLE_REFERENCE:
+                ranges[index] = slotRanges[node.slot];
+                break;
+            case NodeKind::BINARY_EXPRESSION:
+                if (node.op == BinaryOp::DIVIDE) {
+                    ranges[index] = divide(index, ranges[node.left], ranges[node.right]);
+                } else {
+                    ranges[index] = arithmetic(index, ranges[node.left], ranges[node.right]);
+                }
+                break;
+            default:
+                // inputInt() can return anything
+                ranges[index] = ANY_INT;
+                break;
+        }
+    });
+}
+
+RangeAnalysis::Interval RangeAnalysis::arithmetic(NodeIndex index, const Interval& left, const Interval& right) {
+    Interval result;
+    switch ((*program)[index].op) {
+        case BinaryOp::ADD:
+            result = Interval{left.low + right.low, left.high + right.high};
+            break;
+        case BinaryOp::SUBTRACT:
+            result = Interval{left.low - right.high, left.high - right.low};
+            break;
+        default: {
+            // The extremes of a product are products of bounds
+            int64_t corners[] = {left.low * right.low, left.low * right.high,
+                                 left.high * right.low, left.high * right.high};
+            result = Interval{*std::min_element(corners, corners + 4), *std::max_element(corners, corners + 4)};
+            break;
+        }
+    }
+    if (result.low >= INT32_MIN && result.high <= INT32_MAX) {
+        return result;
+    }
+
+    // Results too big for an int wrap around like the engines' do
+    int64_t lowWraps = wraps(result.low);
+    bool always = result.high < INT32_MIN || result.low > INT32_MAX;
+    report(Problem::OVERFLOW, always, index);
+    if (lowWraps != wraps(result.high)) {
+        return ANY_INT;
+    }
+    return Interval{result.low - lowWraps * WRAP, result.high - lowWraps * WRAP};
+}
+
+RangeAnalysis::Interval RangeAnalysis::divide(NodeIndex index, const Interval& left, const Interval& right) {
+    Node& node = (*program)[index];
+    node.flags = static_cast<uint8_t>(node.flags & ~Node::DIVISOR_NONZERO);
+    stats.divisions++;
+    if (!contains(right, 0)) {
+        node.flags |= Node::DIVISOR_NONZERO;
+        stats.provenDivisions++;
+    } else {
+        report(Problem::DIVISION_BY_ZERO, right.low == 0 && right.high == 0, index);
+    }
+
+    // The quotients at the corners, for the negative and the positive
+    // divisors in turn (a divisor of zero gives no quotient)
+    Interval divisors[] = {{right.low, std::min<int64_t>(right.high, -1)},
+                           {std::max<int64_t>(right.low, 1), right.high}};
+    Interval result{INT64_MAX, INT64_MIN};
+    for (const Interval& divisor : divisors) {
+        if (divisor.low > divisor.high) {
+            continue;
+        }
+        int64_t corners[] = {left.low / divisor.low, left.low / divisor.high,
+                             left.high / divisor.low, left.high / divisor.high};
+        result.low = std::min(result.low, *std::min_element(corners, corners + 4));
+        result.high = std::max(result.high, *std::max_element(corners, corners + 4));
+    }
+    if (result.low > result.high) {
+        // Every run that gets here divides by zero
+        return ANY_INT;
+    }
+
+    // Only INT_MIN / -1 goes past INT_MAX, and that fails instead
+    if (result.high > INT32_MAX) {
+        report(Problem::DIVISION_OVERFLOW, left.high == INT32_MIN && right.low == -1 && right.high == -1, index);
+        if (result.low > INT32_MAX) {
+            return ANY_INT;
+        }
+        result.high = INT32_MAX;
+    }
+    return result;
+}
+
+void RangeAnalysis::report(Problem problem, bool always, NodeIndex index) {
+    const Node& node = (*program)[index];
+    found.push_back(Diagnostic{problem, always, node.op, program->locations[index]});
+}
+
+std::string RangeAnalysis::message(const Diagnostic& diagnostic) {
+    std::string problem;
+    switch (diagnostic.problem) {
+        case Problem::DIVISION_BY_ZERO:
+            problem = "division by zero";
+            break;
+        case Problem::DIVISION_OVERFLOW:
+            problem = "integer overflow in division";
+            break;
+        case Problem::OVERFLOW:
+            problem = std::string("integer overflow in '") + symbolOf(diagnostic.op) + "'";
+            break;
+    }
+    if (diagnostic.always) {
+        problem[0] = static_cast<char>(std::toupper(static_cast<unsigned char>(problem[0])));
+    } else {
+        problem = "Possible " + problem;
+    }
+
+    std::stringstream ss;
+    ss << problem << " at line " << diagnostic.location.line << ", column " << diagnostic.location.column;
+    return ss.str();
+}
@@ -0,0 +1,116 @@
+#ifndef RANGE_ANALYSIS_H
+#define RANGE_ANALYSIS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "AST.h"
+
+/**
+ * RangeAnalysis (Value Range Analysis)
+ *
+ * Purpose: Proves before the program runs which runtime checks can never
+ * fail, so the engines can leave them out, and reports every one that
+ * might fail (or wrap around) as a warning with its line and column.
+ *
+ * How it works (abstract interpretation over intervals):
+ * 1. Every expression is given an interval [low, high] holding each
+ *    value it can have in any run: a literal is just itself, inputInt()
+ *    can be any int, and a variable holds the interval of the value last
+ *    assigned to it. MidLang has no control flow, so one pass over the
+ *    statements in program order sees each assignment before the reads
+ *    after it, and no merging of paths is needed.
+ * 2. +, - and * are applied to the operands' bounds in 64-bit
+ *    arithmetic, so a result outside the 32-bit range shows the operation
+ *    may wrap around. If every result wraps by the same amount, the
+ *    interval is shifted by it. Otherwise the result could be any int.
+ * 3. A division takes the smallest and largest quotient at the corners
+ *    of its operands' intervals, once for the negative divisors and once
+ *    for the positive ones: on either side of zero, truncating division
+ *    only ever grows or only ever shrinks in each operand, so nothing
+ *    between the corners goes further. Runs whose divisor is zero fail
+ *    rather than produce a value. A division whose divisor interval does
+ *    not contain 0 is marked Node::DIVISOR_NONZERO.
+ *
+ * Reading a variable needs no check at all. The Resolver already rejects
+ * every read of a variable before its first assignment, so definedness
+ * is not tracked here.
+ *
+ * Run it after the Resolver. The flags stay valid through the Optimizer
+ * and the SsaOptimizer, which only replace an expression by another of
+ * equal value. Warnings are about the program as written, so it is best
+ * run before them.
+ */
+class RangeAnalysis {
+public:
+    /**
+     * Interval - The values an expression can have, bounds included.
+     */
+    struct Interval {
+        int64_t low;
+        int64_t high;
+    };
+
+    /**
+     * What a diagnostic warns about.
+     */
+    enum class Problem : uint8_t {
+        DIVISION_BY_ZERO,   // The divisor may be zero
+        DIVISION_OVERFLOW,  // INT_MIN / -1 may be computed (no int holds the result)
+        OVERFLOW            // +, - or * may wrap around
+    };
+
+    /**
+     * Diagnostic - A check that was not proven safe.
+     */
+    struct Diagnostic {
+        Problem problem;
+        bool always;                // Every run that gets there fails (or wraps)
+        BinaryOp op;
+        SourceLocation location;    // The operator
+    };
+
+    struct Stats {
+        size_t divisions;           // Divisions in the program
+        size_t provenDivisions;     // Of those, marked DIVISOR_NONZERO
+    };
+
+private:
+    ProgramNode* program = nullptr;
+    std::vector<Interval> ranges;       // Node -> its interval
+    std::vector<Interval> slotRanges;   // Slot -> interval of its current value
+    std::vector<Diagnostic> found;
+    Stats stats;
+    TreeWalker walker;
+
+    // Helper methods
+    void analyzeExpression(NodeIndex expression);
+    Interval arithmetic(NodeIndex index, const Interval& left, const Interval& right);
+    Interval divide(NodeIndex index, const Interval& left, const Interval& right);
+    void report(Problem problem, bool always, NodeIndex index);
+
+public:
+    /**
+     * Analyzes a resolved program: fills ranges and diagnostics and sets
+     * or clears the flags of every division.
+     */
+    Stats analyze(ProgramNode* program);
+
+    /**
+     * The interval of a node of the last program analyzed.
+     */
+    const Interval& range(NodeIndex index) const { return ranges[index]; }
+
+    /**
+     * The checks not proven safe, in program order.
+     */
+    const std::vector<Diagnostic>& diagnostics() const { return found; }
+
+    /**
+     * A diagnostic as a warning message ending with its line and column,
+     * e.g. "Possible division by zero at line 3, column 12".
+     */
+    static std::string message(const Diagnostic& diagnostic);
+};
+
+#endif // RANGE_ANALYSIS_H
@@ -0,0 +1,56 @@
+#include "Resolver.h"
+#include "Errors.h"
+#include <sstream>
+
+void Resolver::resolve(ProgramNode* program) {
+    program->slotNames.clear();
+    slots.clear();
+
+    for (NodeIndex statement : program->statements) {
+        resolveStatement(program, statement);
+    }
+
+    slots.clear();
+}
+
+void Resolver::resolveStatement(ProgramNode* program, NodeIndex index) {
+    this->program = program;
+    if (slots.size() < program->symbols.size()) {
+        slots.resize(program->symbols.size(), -1);
+    }
+    Node& statement = (*program)[index];
+
+    // The value is resolved before the target counts as assigned,
+    // so "var x = x + 1;" still reads an undefined x.
+    resolveExpression(statement.left);
+    if (statement.kind == NodeKind::VAR_DECLARATION || statement.kind == NodeKind::ASSIGNMENT) {
+        statement.slot = define(statement.name);
+    }
+}
+
+void Resolver::resolveExpression(NodeIndex index) {
+    // Reads are resolved left to right, so the first undefined variable
+    // in the source is the one reported
+    walker.postOrder(program->nodes.data(), index, [&](NodeIndex current) {
+        Node& expression = (*program)[current];
+        if (expression.kind != NodeKind::VARIABLE_REFERENCE) {
+            // Literals, inputInt() and operators have nothing to resolve
+            return;
+        }
+        int slot = slots[expression.name];
+        if (slot < 0) {
+            std::stringstream ss;
+            ss << "Undefined variable: " << program->symbols.name(expression.name);
+            throw ParseError(ss.str());
+        }
+        expression.slot = slot;
+    });
+}
+
+int Resolver::define(uint32_t name) {
+    if (slots[name] < 0) {
+        slots[name] = static_cast<int>(program->slotNames.size());
+        program->slotNames.push_back(std::string(program->symbols.name(name)));
+    }
+    return slots[name];
+}
@@ -0,0 +1,48 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include <vector>
+#include "AST.h"
+
+/**
+ * Resolver (Name Resolution)
+ *
+ * Purpose: Replaces variable names with dense integer slots before the
+ * program runs, so engines can store variables in a flat array.
+ *
+ * How it works:
+ * 1. Walks the statements in program order (MidLang has no control flow,
+ *    so program order is execution order)
+ * 2. Gives each distinct variable name the next free slot when it is
+ *    first assigned, in a table indexed by the name's symbol
+ * 3. Writes the slot onto every VariableReference and assignment target
+ * 4. Reports reads of variables that have not been assigned yet as
+ *    "Undefined variable" errors, so no engine needs to check at runtime
+ */
+class Resolver {
+private:
+    std::vector<int> slots;            // Symbol -> slot index, -1 if not assigned yet
+    ProgramNode* program = nullptr;    // Program being resolved
+    TreeWalker walker;                 // Visits expressions of any depth
+
+    // Helper methods
+    void resolveExpression(NodeIndex expression);
+    int define(uint32_t name);
+
+public:
+    /**
+     * Resolves every variable in the program and fills program->slotNames.
+     * Throws ParseError on the first undefined variable.
+     */
+    void resolve(ProgramNode* program);
+
+    /**
+     * Resolves one more statement, remembering the variables assigned by
+     * earlier calls. Used for streaming execution, where each statement
+     * is resolved as soon as it is parsed. New slots are appended to
+     * program->slotNames.
+     */
+    void resolveStatement(ProgramNode* program, NodeIndex statement);
+};
+
+#endif // RESOLVER_H
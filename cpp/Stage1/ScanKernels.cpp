@@ -0,0 +1,275 @@
+#include "ScanKernels.h"
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MIDLANG_HAVE_SSE2 1
+#endif
+
+// AVX2 code is compiled with a per-function target attribute, so the rest
+// of the program still runs on processors without it
+#if defined(MIDLANG_HAVE_SSE2) && defined(__GNUC__)
+#include <immintrin.h>
+#define MIDLANG_HAVE_AVX2 1
+#define MIDLANG_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// ---------------------------------------------------------------------------
+// Bit masks: bit i stands for byte i of a block
+// ---------------------------------------------------------------------------
+
+static unsigned lowestBit(uint32_t bits) {
+#ifdef __GNUC__
+    return static_cast<unsigned>(__builtin_ctz(bits));
+#else
+    unsigned bit = 0;
+    while ((bits & 1) == 0) {
+        bits >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+static unsigned highestBit(uint32_t bits) {
+#ifdef __GNUC__
+    return 31 - static_cast<unsigned>(__builtin_clz(bits));
+#else
+    unsigned bit = 0;
+    while (bits >>= 1) {
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+static unsigned bitCount(uint32_t bits) {
+#ifdef __GNUC__
+    return static_cast<unsigned>(__builtin_popcount(bits));
+#else
+    unsigned count = 0;
+    for (; bits != 0; bits &= bits - 1) {
+        count++;
+    }
+    return count;
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// Scalar kernels (also used for the tail of each input)
+// ---------------------------------------------------------------------------
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static bool isWord(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || isDigit(c) || c == '_';
+}
+
+static const char* skipSpaceScalar(const char* p, const char* end) {
+    while (p < end && isSpace(*p)) {
+        p++;
+    }
+    return p;
+}
+
+static const char* skipWordScalar(const char* p, const char* end) {
+    while (p < end && isWord(*p)) {
+        p++;
+    }
+    return p;
+}
+
+static const char* skipDigitsScalar(const char* p, const char* end) {
+    while (p < end && isDigit(*p)) {
+        p++;
+    }
+    return p;
+}
+
+/**
+ * Counts line breaks like countLineBreaks, where afterReturn says whether
+ * the character before p was a '\r' (so a '\n' at p ends the same break).
+ */
+static size_t countLineBreaksFrom(const char* p, const char* end, bool afterReturn, const char** lastBreak) {
+    size_t count = 0;
+    for (; p < end; p++) {
+        if (*p == '\r' || (*p == '\n' && !afterReturn)) {
+            count++;
+        }
+        if (*p == '\r' || *p == '\n') {
+            *lastBreak = p;
+        }
+        afterReturn = (*p == '\r');
+    }
+    return count;
+}
+
+static size_t countLineBreaksScalar(const char* p, const char* end, const char** lastBreak) {
+    return countLineBreaksFrom(p, end, false, lastBreak);
+}
+
+// ---------------------------------------------------------------------------
+// SSE2 kernels: 16 bytes at a time
+// ---------------------------------------------------------------------------
+
+#ifdef MIDLANG_HAVE_SSE2
+
+static const size_t SSE2_BLOCK = 16;
+
+static __m128i spaceSse2(__m128i v) {
+    __m128i blank = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+    __m128i newline = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+    return _mm_or_si128(blank, newline);
+}
+
+// Bytes compare as signed, so bytes above 127 are below every range here
+static __m128i digitSse2(__m128i v) {
+    return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+}
+
+static __m128i wordSse2(__m128i v) {
+    // Setting bit 5 turns upper case letters into lower case ones and
+    // moves no other character into 'a'..'z'
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                   _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+    __m128i underscore = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+    return _mm_or_si128(_mm_or_si128(letter, digitSse2(v)), underscore);
+}
+
+template <__m128i (*inClass)(__m128i), const char* (*skipTail)(const char*, const char*)>
+static const char* skipSse2(const char* p, const char* end) {
+    while (static_cast<size_t>(end - p) >= SSE2_BLOCK) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        uint32_t outside = ~static_cast<uint32_t>(_mm_movemask_epi8(inClass(block))) & 0xFFFF;
+        if (outside != 0) {
+            return p + lowestBit(outside);
+        }
+        p += SSE2_BLOCK;
+    }
+    return skipTail(p, end);
+}
+
+static size_t countLineBreaksSse2(const char* p, const char* end, const char** lastBreak) {
+    size_t count = 0;
+    uint32_t afterReturn = 0;
+    while (static_cast<size_t>(end - p) >= SSE2_BLOCK) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        uint32_t returns = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8('\r'))));
+        uint32_t newlines = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8('\n'))));
+        // A '\n' right after a '\r' belongs to the same break
+        uint32_t ownNewlines = newlines & ~((returns << 1) | afterReturn);
+        count += bitCount(returns) + bitCount(ownNewlines);
+        if ((returns | newlines) != 0) {
+            *lastBreak = p + highestBit(returns | newlines);
+        }
+        afterReturn = returns >> (SSE2_BLOCK - 1);
+        p += SSE2_BLOCK;
+    }
+    return count + countLineBreaksFrom(p, end, afterReturn != 0, lastBreak);
+}
+
+#endif // MIDLANG_HAVE_SSE2
+
+// ---------------------------------------------------------------------------
+// AVX2 kernels: 32 bytes at a time
+// ---------------------------------------------------------------------------
+
+#ifdef MIDLANG_HAVE_AVX2
+
+static const size_t AVX2_BLOCK = 32;
+
+MIDLANG_TARGET_AVX2
+static __m256i spaceAvx2(__m256i v) {
+    __m256i blank = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                    _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')));
+    __m256i newline = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')),
+                                      _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+    return _mm256_or_si256(blank, newline);
+}
+
+MIDLANG_TARGET_AVX2
+static __m256i digitAvx2(__m256i v) {
+    return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)),
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+}
+
+MIDLANG_TARGET_AVX2
+static __m256i wordAvx2(__m256i v) {
+    __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    __m256i letter = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+                                      _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+    __m256i underscore = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+    return _mm256_or_si256(_mm256_or_si256(letter, digitAvx2(v)), underscore);
+}
+
+template <__m256i (*inClass)(__m256i), const char* (*skipTail)(const char*, const char*)>
+MIDLANG_TARGET_AVX2
+static const char* skipAvx2(const char* p, const char* end) {
+    while (static_cast<size_t>(end - p) >= AVX2_BLOCK) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        uint32_t outside = ~static_cast<uint32_t>(_mm256_movemask_epi8(inClass(block)));
+        if (outside != 0) {
+            return p + lowestBit(outside);
+        }
+        p += AVX2_BLOCK;
+    }
+    return skipTail(p, end);
+}
+
+MIDLANG_TARGET_AVX2
+static size_t countLineBreaksAvx2(const char* p, const char* end, const char** lastBreak) {
+    size_t count = 0;
+    uint32_t afterReturn = 0;
+    while (static_cast<size_t>(end - p) >= AVX2_BLOCK) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        uint32_t returns = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\r'))));
+        uint32_t newlines = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\n'))));
+        uint32_t ownNewlines = newlines & ~((returns << 1) | afterReturn);
+        count += bitCount(returns) + bitCount(ownNewlines);
+        if ((returns | newlines) != 0) {
+            *lastBreak = p + highestBit(returns | newlines);
+        }
+        afterReturn = returns >> (AVX2_BLOCK - 1);
+        p += AVX2_BLOCK;
+    }
+    return count + countLineBreaksFrom(p, end, afterReturn != 0, lastBreak);
+}
+
+#endif // MIDLANG_HAVE_AVX2
+
+// ---------------------------------------------------------------------------
+// Selection
+// ---------------------------------------------------------------------------
+
+const ScanKernels& scalarScanKernels() {
+    static const ScanKernels scalar = {"scalar", skipSpaceScalar, skipWordScalar, skipDigitsScalar,
+                                       countLineBreaksScalar};
+    return scalar;
+}
+
+const ScanKernels& selectScanKernels() {
+#ifdef MIDLANG_HAVE_AVX2
+    static const ScanKernels avx2 = {"avx2", skipAvx2<spaceAvx2, skipSse2<spaceSse2, skipSpaceScalar>>,
+                                     skipAvx2<wordAvx2, skipSse2<wordSse2, skipWordScalar>>,
+                                     skipAvx2<digitAvx2, skipSse2<digitSse2, skipDigitsScalar>>, countLineBreaksAvx2};
+    static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+    if (hasAvx2) {
+        return avx2;
+    }
+#endif
+#ifdef MIDLANG_HAVE_SSE2
+    static const ScanKernels sse2 = {"sse2", skipSse2<spaceSse2, skipSpaceScalar>,
+                                     skipSse2<wordSse2, skipWordScalar>,
+                                     skipSse2<digitSse2, skipDigitsScalar>, countLineBreaksSse2};
+    return sse2;
+#else
+    return scalarScanKernels();
+#endif
+}
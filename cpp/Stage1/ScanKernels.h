@@ -0,0 +1,53 @@
+#ifndef SCAN_KERNELS_H
+#define SCAN_KERNELS_H
+
+#include <cstddef>
+
+/**
+ * ScanKernels - Finds the end of runs of one class of characters.
+ *
+ * Purpose: The inner loops of the Lexer, which skip whitespace and read
+ * identifiers and numbers, and of ParallelFrontEnd, which counts the
+ * line breaks of each chunk. Large generated sources are mostly such
+ * runs, so reading them 16 or 32 bytes at a time instead of one
+ * character at a time speeds up lexing.
+ *
+ * How it works: Each skip kernel returns the first character from p on
+ * (p itself if it does not match, end if they all do) that is not in its
+ * class:
+ * - skipSpace: ' ', '\t', '\r' and '\n'
+ * - skipWord: ASCII letters, digits and '_' (the rest of an identifier)
+ * - skipDigits: ASCII digits
+ * countLineBreaks counts the line breaks from p to end the way the Lexer
+ * does ("\r\n", "\r" and "\n" are one each; a '\n' at p counts on its
+ * own) and, if there is any, sets lastBreak to the last '\r' or '\n'.
+ *
+ * The vector versions compare a block of bytes against each character of
+ * the class at once, turn the result into a bit mask with one bit per
+ * byte, and find the first byte outside the class from the lowest clear
+ * bit. The last bytes of the input, too few for a block, are read one at
+ * a time, so no kernel reads past end.
+ *
+ * selectScanKernels() picks the widest implementation the processor
+ * supports when the program starts: AVX2 (32 bytes per instruction),
+ * then SSE2 (16 bytes), then plain loops on other processors.
+ */
+struct ScanKernels {
+    const char* name;   // "avx2", "sse2" or "scalar"
+    const char* (*skipSpace)(const char* p, const char* end);
+    const char* (*skipWord)(const char* p, const char* end);
+    const char* (*skipDigits)(const char* p, const char* end);
+    size_t (*countLineBreaks)(const char* p, const char* end, const char** lastBreak);
+};
+
+/**
+ * The best kernels for this processor (chosen once, then cached).
+ */
+const ScanKernels& selectScanKernels();
+
+/**
+ * The portable kernels, for checking the vector ones against.
+ */
+const ScanKernels& scalarScanKernels();
+
+#endif // SCAN_KERNELS_H
@@ -0,0 +1,214 @@
+#include "SimdKernels.h"
+#include "Arithmetic.h"
+#include <climits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MIDLANG_HAVE_SSE2 1
+#endif
+
+// AVX2 code is compiled with a per-function target attribute, so the rest
+// of the program still runs on processors without it
+#if defined(MIDLANG_HAVE_SSE2) && defined(__GNUC__)
+#include <immintrin.h>
+#define MIDLANG_HAVE_AVX2 1
+#define MIDLANG_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// ---------------------------------------------------------------------------
+// Scalar kernels (also used for the tail of each column)
+// ---------------------------------------------------------------------------
+
+static void addScalar(const int32_t* a, const int32_t* b, int32_t* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = wrapAdd(a[i], b[i]);
+    }
+}
+
+static void subtractScalar(const int32_t* a, const int32_t* b, int32_t* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = wrapSub(a[i], b[i]);
+    }
+}
+
+static void multiplyScalar(const int32_t* a, const int32_t* b, int32_t* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = wrapMul(a[i], b[i]);
+    }
+}
+
+static bool divideScalar(const int32_t* a, const int32_t* b, int32_t* out, uint8_t* failed, size_t count) {
+    bool any = false;
+    for (size_t i = 0; i < count; i++) {
+        if (b[i] == 0 || (a[i] == INT_MIN && b[i] == -1)) {
+            out[i] = 0;
+            failed[i] = 1;
+            any = true;
+        } else {
+            out[i] = a[i] / b[i];
+        }
+    }
+    return any;
+}
+
+// ---------------------------------------------------------------------------
+// SSE2 kernels: 4 rows at a time
+// ---------------------------------------------------------------------------
+
+#ifdef MIDLANG_HAVE_SSE2
+
+static void addSse2(const int32_t* a, const int32_t* b, int32_t* out, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_add_epi32(x, y));
+    }
+    addScalar(a + i, b + i, out + i, count - i);
+}
+
+static void subtractSse2(const int32_t* a, const int32_t* b, int32_t* out, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_sub_epi32(x, y));
+    }
+    subtractScalar(a + i, b + i, out + i, count - i);
+}
+
+static void multiplySse2(const int32_t* a, const int32_t* b, int32_t* out, size_t count) {
+    // SSE2 has no 32-bit low multiply: multiply the even and odd lanes
+    // as 64-bit products and put the low halves back together
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        __m128i even = _mm_mul_epu32(x, y);
+        __m128i odd = _mm_mul_epu32(_mm_srli_si128(x, 4), _mm_srli_si128(y, 4));
+        __m128i result = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                                            _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), result);
+    }
+    multiplyScalar(a + i, b + i, out + i, count - i);
+}
+
+static bool divideSse2(const int32_t* a, const int32_t* b, int32_t* out, uint8_t* failed, size_t count) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i minusOne = _mm_set1_epi32(-1);
+    const __m128i minimum = _mm_set1_epi32(INT_MIN);
+    bool any = false;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        __m128i bad = _mm_or_si128(_mm_cmpeq_epi32(y, zero),
+                                   _mm_and_si128(_mm_cmpeq_epi32(y, minusOne), _mm_cmpeq_epi32(x, minimum)));
+        if (_mm_movemask_epi8(bad) != 0) {
+            any = divideScalar(a + i, b + i, out + i, failed + i, 4) || any;
+            continue;
+        }
+        // Two rows per double-precision division; truncation matches C++
+        __m128d low = _mm_div_pd(_mm_cvtepi32_pd(x), _mm_cvtepi32_pd(y));
+        __m128d high = _mm_div_pd(_mm_cvtepi32_pd(_mm_srli_si128(x, 8)), _mm_cvtepi32_pd(_mm_srli_si128(y, 8)));
+        __m128i result = _mm_unpacklo_epi64(_mm_cvttpd_epi32(low), _mm_cvttpd_epi32(high));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), result);
+    }
+    return divideScalar(a + i, b + i, out + i, failed + i, count - i) || any;
+}
+
+#endif // MIDLANG_HAVE_SSE2
+
+// ---------------------------------------------------------------------------
+// AVX2 kernels: 8 rows at a time
+// ---------------------------------------------------------------------------
+
+#ifdef MIDLANG_HAVE_AVX2
+
+MIDLANG_TARGET_AVX2
+static void addAvx2(const int32_t* a, const int32_t* b, int32_t* out, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_add_epi32(x, y));
+    }
+    addScalar(a + i, b + i, out + i, count - i);
+}
+
+MIDLANG_TARGET_AVX2
+static void subtractAvx2(const int32_t* a, const int32_t* b, int32_t* out, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_sub_epi32(x, y));
+    }
+    subtractScalar(a + i, b + i, out + i, count - i);
+}
+
+MIDLANG_TARGET_AVX2
+static void multiplyAvx2(const int32_t* a, const int32_t* b, int32_t* out, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_mullo_epi32(x, y));
+    }
+    multiplyScalar(a + i, b + i, out + i, count - i);
+}
+
+MIDLANG_TARGET_AVX2
+static bool divideAvx2(const int32_t* a, const int32_t* b, int32_t* out, uint8_t* failed, size_t count) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i minusOne = _mm256_set1_epi32(-1);
+    const __m256i minimum = _mm256_set1_epi32(INT_MIN);
+    bool any = false;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        __m256i bad = _mm256_or_si256(_mm256_cmpeq_epi32(y, zero),
+                                      _mm256_and_si256(_mm256_cmpeq_epi32(y, minusOne),
+                                                       _mm256_cmpeq_epi32(x, minimum)));
+        if (_mm256_movemask_epi8(bad) != 0) {
+            any = divideScalar(a + i, b + i, out + i, failed + i, 8) || any;
+            continue;
+        }
+        // Four rows per double-precision division; truncation matches C++
+        __m256d low = _mm256_div_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(x)),
+                                    _mm256_cvtepi32_pd(_mm256_castsi256_si128(y)));
+        __m256d high = _mm256_div_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(x, 1)),
+                                     _mm256_cvtepi32_pd(_mm256_extracti128_si256(y, 1)));
+        __m256i result = _mm256_set_m128i(_mm256_cvttpd_epi32(high), _mm256_cvttpd_epi32(low));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), result);
+    }
+    return divideScalar(a + i, b + i, out + i, failed + i, count - i) || any;
+}
+
+#endif // MIDLANG_HAVE_AVX2
+
+// ---------------------------------------------------------------------------
+// Selection
+// ---------------------------------------------------------------------------
+
+const SimdKernels& scalarKernels() {
+    static const SimdKernels kernels = {"scalar", addScalar, subtractScalar, multiplyScalar, divideScalar};
+    return kernels;
+}
+
+const SimdKernels& selectKernels() {
+#ifdef MIDLANG_HAVE_AVX2
+    static const SimdKernels avx2 = {"avx2", addAvx2, subtractAvx2, multiplyAvx2, divideAvx2};
+    static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+    if (hasAvx2) {
+        return avx2;
+    }
+#endif
+#ifdef MIDLANG_HAVE_SSE2
+    static const SimdKernels sse2 = {"sse2", addSse2, subtractSse2, multiplySse2, divideSse2};
+    return sse2;
+#else
+    return scalarKernels();
+#endif
+}
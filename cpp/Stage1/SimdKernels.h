@@ -0,0 +1,44 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * SimdKernels - Arithmetic on whole columns of 32-bit integers.
+ *
+ * Purpose: The inner loops of batch evaluation (see Batch.h), which
+ * apply one operator to thousands of rows at a time.
+ *
+ * How it works: Each kernel reads count values from a and b and writes
+ * count results to out (out may be a or b). Arithmetic wraps around like
+ * the engines' 32-bit ints. divide() also sets failed[i] = 1 for every
+ * row whose divisor is zero or whose quotient overflows (INT_MIN / -1)
+ * and writes 0 there, and returns whether it set any; other entries of
+ * failed are left alone.
+ *
+ * selectKernels() picks the widest implementation the processor
+ * supports when the program starts: AVX2 (8 rows per instruction), then
+ * SSE2 (4 rows), then plain loops on other processors. Division has no
+ * integer SIMD instruction, so the vector versions divide in double
+ * precision, which is exact for 32-bit operands.
+ */
+struct SimdKernels {
+    const char* name;   // "avx2", "sse2" or "scalar"
+    void (*add)(const int32_t* a, const int32_t* b, int32_t* out, size_t count);
+    void (*subtract)(const int32_t* a, const int32_t* b, int32_t* out, size_t count);
+    void (*multiply)(const int32_t* a, const int32_t* b, int32_t* out, size_t count);
+    bool (*divide)(const int32_t* a, const int32_t* b, int32_t* out, uint8_t* failed, size_t count);
+};
+
+/**
+ * The best kernels for this processor (chosen once, then cached).
+ */
+const SimdKernels& selectKernels();
+
+/**
+ * The portable kernels, for checking the vector ones against.
+ */
+const SimdKernels& scalarKernels();
+
+#endif // SIMD_KERNELS_H
@@ -0,0 +1,74 @@
+#include "SourceFile.h"
+#include <fstream>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MIDLANG_HAVE_MMAP 1
+#endif
+
+SourceFile::SourceFile() : mapping(nullptr), mappingSize(0), released(0) {}
+
+SourceFile::~SourceFile() {
+#ifdef MIDLANG_HAVE_MMAP
+    if (mapping != nullptr) {
+        munmap(mapping, mappingSize);
+    }
+#endif
+}
+
+bool SourceFile::open(const std::string& path) {
+#ifdef MIDLANG_HAVE_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void* address = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED) {
+            // The lexer reads front to back, so let the kernel read ahead
+            madvise(address, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+            close(fd);
+            mapping = address;
+            mappingSize = static_cast<size_t>(info.st_size);
+            contents = std::string_view(static_cast<const char*>(address), mappingSize);
+            return true;
+        }
+    }
+    close(fd);
+    // Empty files, pipes and failed mappings are read normally below
+#endif
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::stringstream stream;
+    stream << file.rdbuf();
+    buffer = stream.str();
+    contents = buffer;
+    return true;
+}
+
+void SourceFile::release(size_t offset) {
+#ifdef MIDLANG_HAVE_MMAP
+    if (mapping == nullptr) {
+        return;
+    }
+
+    // Only whole pages can be dropped
+    size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t end = offset / pageSize * pageSize;
+    if (end > released) {
+        madvise(static_cast<char*>(mapping) + released, end - released, MADV_DONTNEED);
+        released = end;
+    }
+#else
+    (void)offset;
+#endif
+}
@@ -0,0 +1,48 @@
+#ifndef SOURCE_FILE_H
+#define SOURCE_FILE_H
+
+#include <string>
+#include <string_view>
+
+/**
+ * SourceFile - Read-only view of a source file's contents.
+ *
+ * On POSIX systems the file is memory-mapped, so opening even a
+ * multi-gigabyte script costs no copying: pages are read from disk as the
+ * lexer reaches them. On other systems the file is read into memory once.
+ */
+class SourceFile {
+private:
+    std::string_view contents;
+    void* mapping;       // Start of the mapping, or nullptr
+    size_t mappingSize;
+    size_t released;     // Bytes already handed back by release()
+    std::string buffer;  // Holds the contents when the file is not mapped
+
+public:
+    SourceFile();
+    ~SourceFile();
+
+    SourceFile(const SourceFile&) = delete;
+    SourceFile& operator=(const SourceFile&) = delete;
+
+    /**
+     * Opens and maps a file. Returns false if it cannot be opened.
+     */
+    bool open(const std::string& path);
+
+    /**
+     * The file's contents. Valid until the SourceFile is destroyed.
+     */
+    std::string_view text() const { return contents; }
+
+    /**
+     * Tells the system that the first "offset" bytes will not be read
+     * again, so their pages can be dropped from memory. Streaming
+     * execution calls this as it moves through the file, which keeps
+     * memory use bounded no matter how large the file is.
+     */
+    void release(size_t offset);
+};
+
+#endif // SOURCE_FILE_H
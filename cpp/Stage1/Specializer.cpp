@@ -0,0 +1,141 @@
+#include "Specializer.h"
+#include "Arithmetic.h"
+#include <climits>
+
+Specializer::Stats Specializer::specialize(const ProgramNode& program, std::ostream& out) {
+    this->program = &program;
+    this->out = &out;
+    known.assign(program.nodes.size(), 0);
+    values.assign(program.nodes.size(), 0);
+    slotKnown.assign(program.slotNames.size(), 0);
+    slotValues.assign(program.slotNames.size(), 0);
+    Stats stats{program.statements.size(), 0, 0};
+
+    for (NodeIndex index : program.statements) {
+        const Node& statement = program[index];
+        bool fails = evaluate(statement.left);
+        bool isKnown = known[statement.left] != 0;
+
+        if (statement.kind == NodeKind::PRINT) {
+            out << "print(";
+            writeExpression(statement.left);
+            out << ");\n";
+            if (isKnown) {
+                stats.knownPrints++;
+            } else {
+                stats.residualStatements++;
+            }
+        } else if (isKnown) {
+            // Nothing to do at runtime: later reads see the value instead
+            slotKnown[statement.slot] = 1;
+            slotValues[statement.slot] = values[statement.left];
+        } else {
+            out << (statement.kind == NodeKind::VAR_DECLARATION ? "var " : "") << program.symbols.name(statement.name)
+                << " = ";
+            writeExpression(statement.left);
+            out << ";\n";
+            slotKnown[statement.slot] = 0;
+            stats.residualStatements++;
+        }
+
+        // Every run stops with an error here, so nothing after it runs
+        if (fails) {
+            break;
+        }
+    }
+    return stats;
+}
+
+bool Specializer::evaluate(NodeIndex expression) {
+    bool fails = false;
+    walker.postOrder(program->nodes.data(), expression, [&](NodeIndex index) {
+        const Node& node = (*program)[index];
+        switch (node.kind) {
+            case NodeKind::INTEGER_LITERAL:
+                known[index] = 1;
+                values[index] = node.value;
+                break;
+            case NodeKind::VARIABLE_REFERENCE:
+                known[index] = slotKnown[node.slot];
+                values[index] = slotValues[node.slot];
+                break;
+            case NodeKind::BINARY_EXPRESSION: {
+                known[index] = 0;
+                if (!known[node.left] || !known[node.right]) {
+                    break;
+                }
+                int32_t left = values[node.left];
+                int32_t right = values[node.right];
+                switch (node.op) {
+                    case BinaryOp::ADD:
+                        values[index] = wrapAdd(left, right);
+                        break;
+                    case BinaryOp::SUBTRACT:
+                        values[index] = wrapSub(left, right);
+                        break;
+                    case BinaryOp::MULTIPLY:
+                        values[index] = wrapMul(left, right);
+                        break;
+                    case BinaryOp::DIVIDE:
+                        // Left to fail at runtime, with its operands computed
+                        if (right == 0 || (left == INT32_MIN && right == -1)) {
+                            fails = true;
+                            return;
+                        }
+                        values[index] = left / right;
+                        break;
+                }
+                known[index] = 1;
+                break;
+            }
+            default:
+                // inputInt() is only known when the program runs
+                known[index] = 0;
+                break;
+        }
+    });
+    return fails;
+}
+
+void Specializer::writeExpression(NodeIndex expression) {
+    // Written with an explicit stack: expressions can nest far deeper
+    // than the call stack allows
+    std::ostream& out = *this->out;
+    frames.push_back(Frame{expression, 0});
+    while (!frames.empty()) {
+        Frame& frame = frames.back();
+        const Node& node = (*program)[frame.index];
+        if (known[frame.index]) {
+            writeLiteral(values[frame.index]);
+            frames.pop_back();
+        } else if (node.kind == NodeKind::INPUT_INT) {
+            out << "inputInt()";
+            frames.pop_back();
+        } else if (node.kind == NodeKind::VARIABLE_REFERENCE) {
+            out << program->symbols.name(node.name);
+            frames.pop_back();
+        } else if (frame.stage == 0) {
+            frame.stage = 1;
+            out << '(';
+            frames.push_back(Frame{node.left, 0});
+        } else if (frame.stage == 1) {
+            frame.stage = 2;
+            out << ' ' << symbolOf(node.op) << ' ';
+            frames.push_back(Frame{node.right, 0});
+        } else {
+            out << ')';
+            frames.pop_back();
+        }
+    }
+}
+
+void Specializer::writeLiteral(int32_t value) {
+    // There are no negative literals, and 2147483648 does not fit in one
+    if (value == INT32_MIN) {
+        *out << "(0 - 2147483647 - 1)";
+    } else if (value < 0) {
+        *out << "(0 - " << -value << ")";
+    } else {
+        *out << value;
+    }
+}
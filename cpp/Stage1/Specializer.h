@@ -0,0 +1,76 @@
+#ifndef SPECIALIZER_H
+#define SPECIALIZER_H
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "AST.h"
+
+/**
+ * Specializer (Partial Evaluation)
+ *
+ * Purpose: Runs ahead of time every part of a program that does not
+ * depend on inputInt(), and writes what is left as a new MidLang
+ * program. Scripts that build large fixed tables and then combine them
+ * with a few input values do the fixed work once, at build time, instead
+ * of on every run.
+ *
+ * How it works (one pass over the statements, in program order):
+ * 1. Every expression whose value is known is computed, with the
+ *    engines' 32-bit wrap-around arithmetic. Literals are known, and so
+ *    is a variable whose last assignment was known; inputInt() is not,
+ *    and neither is anything computed from it.
+ * 2. An assignment of a known value only records it and is left out of
+ *    the result. A print of a known value becomes print(<literal>).
+ * 3. Every other statement is written out in place, with each known
+ *    part of its expression replaced by its value. inputInt() calls
+ *    therefore happen in the same order, between the same prints.
+ * 4. A division that would fail (by zero, or INT_MIN / -1) is not
+ *    computed. It stays in the result, so the error happens at the same
+ *    point in the output. The statements after it can never run, so
+ *    they are dropped.
+ *
+ * The result prints exactly what the original prints, for any input,
+ * and fails with the same error after the same output. Negative values
+ * are written as (0 - n), since MidLang has no negative literals.
+ *
+ * Run it after the Resolver, on a tree the Optimizer has not touched, so
+ * the result keeps the original variable names.
+ */
+class Specializer {
+public:
+    struct Stats {
+        size_t statements;          // Statements in the program
+        size_t residualStatements;  // Statements left to run (they depend on input, or fail)
+        size_t knownPrints;         // Prints of known values, written as print(<literal>)
+    };
+
+private:
+    // A node of an expression still being written out
+    struct Frame {
+        NodeIndex index;
+        uint8_t stage;      // 0: nothing written, 1: "(" and the left operand, 2: and the right one
+    };
+
+    const ProgramNode* program = nullptr;
+    std::ostream* out = nullptr;
+    std::vector<uint8_t> known;         // Node -> whether its value is known
+    std::vector<int32_t> values;        // Node -> its value, if known
+    std::vector<uint8_t> slotKnown;     // Slot -> whether its current value is known
+    std::vector<int32_t> slotValues;
+    std::vector<Frame> frames;
+    TreeWalker walker;
+
+    // Helper methods
+    bool evaluate(NodeIndex expression);
+    void writeExpression(NodeIndex expression);
+    void writeLiteral(int32_t value);
+
+public:
+    /**
+     * Writes the residual program of a resolved program to out.
+     */
+    Stats specialize(const ProgramNode& program, std::ostream& out);
+};
+
+#endif // SPECIALIZER_H
@@ -0,0 +1,319 @@
+#include "SsaOptimizer.h"
+#include <string>
+
+SsaOptimizer::Stats SsaOptimizer::optimize(ProgramNode* program) {
+    this->program = program;
+    stats = Stats{};
+    expressions.clear();
+    literals.clear();
+    remaining.clear();
+    homes.clear();
+    nextValue = 0;
+
+    size_t nodeCount = program->nodes.size();
+    nodeValues.assign(nodeCount, 0);
+    sizes.assign(nodeCount, 0);
+    counted.assign(nodeCount, false);
+    expressions.reserve(nodeCount);
+    remaining.reserve(nodeCount + program->slotNames.size());
+    homes.reserve(nodeCount + program->slotNames.size());
+
+    // Value numbers 0..slots-1 stand for the (never read) initial values
+    size_t slotCount = program->slotNames.size();
+    slotValues.resize(slotCount);
+    for (size_t slot = 0; slot < slotCount; slot++) {
+        slotValues[slot] = newValue();
+    }
+    slotSymbols.assign(slotCount, -1);
+
+    // 1. Number every expression and count how often each one comes up
+    size_t before = 0;
+    for (NodeIndex statement : program->statements) {
+        const Node& node = (*program)[statement];
+        uint32_t value = number(node.left);
+        count(node.left);
+        before += 1 + sizes[node.left];
+        if (node.kind != NodeKind::PRINT) {
+            slotValues[node.slot] = value;
+        }
+    }
+
+    // 2. Replace repeated expressions, replaying the same assignments
+    for (size_t slot = 0; slot < slotCount; slot++) {
+        slotValues[slot] = static_cast<uint32_t>(slot);
+    }
+    std::vector<NodeIndex> statements;
+    statements.reserve(program->statements.size());
+    for (NodeIndex statement : program->statements) {
+        Node node = (*program)[statement];
+        uint32_t value = nodeValues[node.left];
+        std::vector<NodeIndex> hoisted;
+        NodeIndex expression = rewrite(node.left, node.kind != NodeKind::PRINT, hoisted);
+        (*program)[statement].left = expression;
+        statements.insert(statements.end(), hoisted.begin(), hoisted.end());
+        statements.push_back(statement);
+        if (node.kind != NodeKind::PRINT) {
+            slotValues[node.slot] = value;
+            if (holder(value) < 0) {
+                homes[value] = node.slot;
+            }
+        }
+    }
+    program->statements = std::move(statements);
+
+    // 3. Drop assignments nothing reads
+    eliminateDeadStores();
+
+    // 4. Keep only the live nodes
+    ProgramNode live;
+    live.symbols = std::move(program->symbols);
+    live.slotNames = std::move(program->slotNames);
+    for (NodeIndex statement : program->statements) {
+        live.statements.push_back(walker.copy(*program, live, statement));
+    }
+    stats.nodesRemoved = before > live.nodes.size() ? before - live.nodes.size() : 0;
+    *program = std::move(live);
+
+    this->program = nullptr;
+    return stats;
+}
+
+uint32_t SsaOptimizer::newValue() {
+    remaining.push_back(0);
+    homes.push_back(-1);
+    return nextValue++;
+}
+
+uint32_t SsaOptimizer::number(NodeIndex root) {
+    // Children first, so operands are numbered before their operator
+    walker.postOrder(program->nodes.data(), root, [&](NodeIndex index) {
+        const Node& node = (*program)[index];
+        uint32_t value;
+        sizes[index] = 1;
+        switch (node.kind) {
+            case NodeKind::INTEGER_LITERAL: {
+                auto found = literals.find(node.value);
+                if (found == literals.end()) {
+                    found = literals.emplace(node.value, newValue()).first;
+                }
+                value = found->second;
+                break;
+            }
+            case NodeKind::VARIABLE_REFERENCE:
+                value = slotValues[node.slot];
+                break;
+            case NodeKind::BINARY_EXPRESSION: {
+                uint32_t left = nodeValues[node.left];
+                uint32_t right = nodeValues[node.right];
+                sizes[index] += sizes[node.left] + sizes[node.right];
+                // a + b and b + a are the same value
+                if ((node.op == BinaryOp::ADD || node.op == BinaryOp::MULTIPLY) && left > right) {
+                    std::swap(left, right);
+                }
+                Key key{node.op, left, right};
+                auto found = expressions.find(key);
+                if (found == expressions.end()) {
+                    found = expressions.emplace(key, newValue()).first;
+                }
+                value = found->second;
+                break;
+            }
+            default:
+                // Every inputInt() reads a new value
+                value = newValue();
+                break;
+        }
+        nodeValues[index] = value;
+    });
+    return nodeValues[root];
+}
+
+void SsaOptimizer::count(NodeIndex root) {
+    // A repeat of an expression already seen will be replaced as a whole,
+    // so the expressions inside it are not counted again
+    pending.clear();
+    pending.push_back(root);
+    while (!pending.empty()) {
+        NodeIndex index = pending.back();
+        pending.pop_back();
+        const Node& node = (*program)[index];
+        if (node.kind != NodeKind::BINARY_EXPRESSION) {
+            continue;
+        }
+        counted[index] = true;
+        if (remaining[nodeValues[index]]++ > 0) {
+            continue;
+        }
+        pending.push_back(node.right);
+        pending.push_back(node.left);
+    }
+}
+
+void SsaOptimizer::skip(NodeIndex root) {
+    // Un-counts an occurrence that is being replaced without being visited
+    pending.clear();
+    pending.push_back(root);
+    while (!pending.empty()) {
+        NodeIndex index = pending.back();
+        pending.pop_back();
+        if (!counted[index]) {
+            continue;
+        }
+        const Node& node = (*program)[index];
+        remaining[nodeValues[index]]--;
+        pending.push_back(node.right);
+        pending.push_back(node.left);
+    }
+}
+
+int32_t SsaOptimizer::holder(uint32_t value) const {
+    int32_t slot = homes[value];
+    return (slot >= 0 && slotValues[slot] == value) ? slot : -1;
+}
+
+NodeIndex SsaOptimizer::rewrite(NodeIndex root, bool wholeValue, std::vector<NodeIndex>& hoisted) {
+    // Top-down, left before right, since replacing one operand changes
+    // what the next one can reuse
+    frames.clear();
+    results.clear();
+    frames.push_back(Frame{root, wholeValue, false, false});
+    while (!frames.empty()) {
+        Frame frame = frames.back();
+        const Node node = (*program)[frame.index];
+        uint32_t value = nodeValues[frame.index];
+
+        if (!frame.expanded) {
+            if (node.kind != NodeKind::BINARY_EXPRESSION) {
+                frames.pop_back();
+                results.push_back(frame.index);
+                continue;
+            }
+
+            // Some variable still holds this value (it was computed, so it did not fail)
+            int32_t slot = holder(value);
+            if (slot >= 0) {
+                frames.pop_back();
+                skip(frame.index);
+                stats.expressionsReused++;
+                results.push_back(read(slot, frame.index));
+                continue;
+            }
+
+            if (counted[frame.index]) {
+                remaining[value]--;
+            }
+            // Nodes with a temporary: 1 for its declaration, the expression once,
+            // and one read per use. The whole value of an assignment needs no
+            // temporary: its variable holds it afterwards.
+            size_t uses = remaining[value] + 1;
+            size_t size = sizes[frame.index];
+            frames.back().hoist = !frame.wholeValue && remaining[value] > 0 && uses * size > uses + size + 1
+                                  && isPure(frame.index);
+            frames.back().expanded = true;
+            frames.push_back(Frame{node.right, false, false, false});
+            frames.push_back(Frame{node.left, false, false, false});
+            continue;
+        }
+
+        frames.pop_back();
+        NodeIndex right = results.back();
+        results.pop_back();
+        NodeIndex left = results.back();
+        results.pop_back();
+        (*program)[frame.index].left = left;
+        (*program)[frame.index].right = right;
+        if (!frame.hoist) {
+            results.push_back(frame.index);
+            continue;
+        }
+
+        int32_t temporary = static_cast<int32_t>(program->slotNames.size());
+        std::string name = "$t" + std::to_string(stats.temporaries++);
+        program->slotNames.push_back(name);
+        slotValues.push_back(value);
+        slotSymbols.push_back(static_cast<int32_t>(program->symbols.intern(name)));
+        homes[value] = temporary;
+
+        Node declaration = Node::statement(NodeKind::VAR_DECLARATION, frame.index, slotSymbols[temporary]);
+        declaration.slot = temporary;
+        SourceLocation location = program->locations[frame.index];
+        hoisted.push_back(program->add(declaration, location));
+        results.push_back(read(temporary, frame.index));
+    }
+    return results.back();
+}
+
+NodeIndex SsaOptimizer::read(int32_t slot, NodeIndex replacing) {
+    if (slotSymbols[slot] < 0) {
+        slotSymbols[slot] = static_cast<int32_t>(program->symbols.intern(program->slotNames[slot]));
+    }
+    Node node = Node::variableReference(static_cast<uint32_t>(slotSymbols[slot]));
+    node.slot = slot;
+    SourceLocation location = program->locations[replacing];
+    return program->add(node, location);
+}
+
+void SsaOptimizer::eliminateDeadStores() {
+    // Walking backward, live[slot] says whether the current version of
+    // the variable is read by a statement that is kept
+    std::vector<bool> live(program->slotNames.size(), false);
+    std::vector<NodeIndex> kept;
+    kept.reserve(program->statements.size());
+    for (size_t i = program->statements.size(); i-- > 0;) {
+        NodeIndex statement = program->statements[i];
+        const Node& node = (*program)[statement];
+        if (node.kind != NodeKind::PRINT) {
+            const Node& value = (*program)[node.left];
+            bool copiesItself = value.kind == NodeKind::VARIABLE_REFERENCE && value.slot == node.slot;
+            if (copiesItself || (!live[node.slot] && !hasEffect(node.left))) {
+                stats.statementsRemoved++;
+                continue;
+            }
+            live[node.slot] = false;
+        }
+        markReads(node.left, live);
+        kept.push_back(statement);
+    }
+    program->statements.assign(kept.rbegin(), kept.rend());
+}
+
+bool SsaOptimizer::isPure(NodeIndex index) {
+    return !hasEffect(index);
+}
+
+bool SsaOptimizer::hasEffect(NodeIndex root) {
+    // inputInt() reads input; a division fails on zero (or traps on
+    // INT_MIN / -1) unless its divisor is a safe literal
+    pending.clear();
+    pending.push_back(root);
+    while (!pending.empty()) {
+        const Node& node = (*program)[pending.back()];
+        pending.pop_back();
+        switch (node.kind) {
+            case NodeKind::INPUT_INT:
+                return true;
+            case NodeKind::BINARY_EXPRESSION:
+                if (node.op == BinaryOp::DIVIDE) {
+                    const Node& divisor = (*program)[node.right];
+                    if (divisor.kind != NodeKind::INTEGER_LITERAL || divisor.value == 0 || divisor.value == -1) {
+                        return true;
+                    }
+                }
+                pending.push_back(node.left);
+                pending.push_back(node.right);
+                break;
+            default:
+                break;
+        }
+    }
+    return false;
+}
+
+void SsaOptimizer::markReads(NodeIndex root, std::vector<bool>& live) {
+    walker.postOrder(program->nodes.data(), root, [&](NodeIndex index) {
+        const Node& node = (*program)[index];
+        if (node.kind == NodeKind::VARIABLE_REFERENCE) {
+            live[node.slot] = true;
+        }
+    });
+}
@@ -0,0 +1,112 @@
+#ifndef SSA_OPTIMIZER_H
+#define SSA_OPTIMIZER_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "AST.h"
+
+/**
+ * SsaOptimizer (Dead Store and Common Subexpression Elimination)
+ *
+ * Purpose: Removes work that generated programs repeat: assignments whose
+ * value is never printed, and identical expressions computed again while
+ * their inputs are unchanged.
+ *
+ * How it works:
+ * A MidLang program is straight-line code, so every assignment already
+ * starts a new version of its variable, as in SSA form, and every read
+ * sees exactly one of those versions.
+ * 1. Value numbering: walking forward, every expression gets a number
+ *    that depends only on its operator and the numbers of its operands,
+ *    and a variable read gets the number of the version it reads. Equal
+ *    numbers mean equal values.
+ * 2. Common subexpressions: an expression whose value some variable
+ *    still holds is replaced by a read of that variable. A pure
+ *    expression that comes up again later, with no variable holding it,
+ *    is computed once into a new temporary ("var $t0 = ...;" just before
+ *    its first use) when that saves nodes overall.
+ * 3. Dead stores: walking backward, an assignment is kept only if a later
+ *    statement that is kept reads that version, or if its expression has
+ *    an effect of its own (inputInt(), or a division that might fail).
+ * 4. The surviving nodes are copied into a fresh arena.
+ * Every walk keeps its stack on the heap, so expressions of any depth
+ * are handled.
+ *
+ * inputInt() calls, prints and runtime errors happen in the same order as
+ * before; temporaries only ever hold pure expressions, which cannot fail.
+ * Variables' final values are not observable from the command line, so
+ * they are not kept alive. Run it after the Resolver (and Optimizer).
+ */
+class SsaOptimizer {
+public:
+    struct Stats {
+        size_t statementsRemoved;   // Dead stores dropped
+        size_t expressionsReused;   // Expressions replaced by a variable or temporary
+        size_t temporaries;         // Temporaries introduced
+        size_t nodesRemoved;        // Net change in tree size
+    };
+
+    /**
+     * Optimizes a resolved program in place.
+     */
+    Stats optimize(ProgramNode* program);
+
+private:
+    // Value numbering key of a binary expression
+    struct Key {
+        BinaryOp op;
+        uint32_t left;
+        uint32_t right;
+        bool operator==(const Key& other) const {
+            return op == other.op && left == other.left && right == other.right;
+        }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return (static_cast<size_t>(key.left) * 0x9E3779B1u) ^ (static_cast<size_t>(key.right) << 7)
+                   ^ static_cast<size_t>(key.op);
+        }
+    };
+
+    ProgramNode* program = nullptr;
+    uint32_t nextValue = 0;
+    std::unordered_map<Key, uint32_t, KeyHash> expressions;
+    std::unordered_map<int32_t, uint32_t> literals;
+    std::vector<uint32_t> nodeValues;    // Node -> value number
+    std::vector<uint32_t> slotValues;    // Slot -> value number it holds now
+    std::vector<uint32_t> remaining;     // Value number -> occurrences not yet visited
+    std::vector<int32_t> homes;          // Value number -> a slot that may hold it, or -1
+    std::vector<uint32_t> sizes;         // Node -> nodes in its subtree
+    std::vector<bool> counted;           // Node -> counted in remaining
+    std::vector<int32_t> slotSymbols;     // Slot -> symbol of its name for new reads, or -1
+
+    // A node rewrite() has entered but not finished
+    struct Frame {
+        NodeIndex index;
+        bool wholeValue;  // The whole value of an assignment
+        bool expanded;    // Operands already pushed
+        bool hoist;       // Becomes a temporary once its operands are done
+    };
+
+    // Scratch stacks, reused by every walk
+    std::vector<Frame> frames;
+    std::vector<NodeIndex> results;
+    std::vector<NodeIndex> pending;
+    TreeWalker walker;
+    Stats stats{};
+
+    uint32_t newValue();
+    uint32_t number(NodeIndex index);
+    void count(NodeIndex index);
+    void skip(NodeIndex index);
+    NodeIndex rewrite(NodeIndex index, bool wholeValue, std::vector<NodeIndex>& hoisted);
+    int32_t holder(uint32_t value) const;
+    NodeIndex read(int32_t slot, NodeIndex replacing);
+    void eliminateDeadStores();
+    bool isPure(NodeIndex index);
+    bool hasEffect(NodeIndex index);
+    void markReads(NodeIndex index, std::vector<bool>& live);
+};
+
+#endif // SSA_OPTIMIZER_H
@@ -0,0 +1,28 @@
+#include "Streaming.h"
+
+// Source pages are released in steps of this many bytes
+static const size_t RELEASE_INTERVAL = 16 * 1024 * 1024;
+
+StreamingInterpreter::StreamingInterpreter(SourceFile& file, OutputSink& output, InputSource& input)
+    : file(file), lexer(file.text()), parser(tokens), evaluator(output, input) {}
+
+size_t StreamingInterpreter::run() {
+    size_t count = 0;
+    size_t nextRelease = RELEASE_INTERVAL;
+
+    while (lexer.tokenizeStatement(tokens)) {
+        NodeIndex statement = parser.parseSingleStatement(program);
+        resolver.resolveStatement(&program, statement);
+        evaluator.evaluate(&program, statement);
+
+        program.clearStatements();
+        count++;
+
+        if (lexer.offset() >= nextRelease) {
+            file.release(lexer.offset());
+            nextRelease = lexer.offset() + RELEASE_INTERVAL;
+        }
+    }
+
+    return count;
+}
@@ -0,0 +1,55 @@
+#ifndef STREAMING_H
+#define STREAMING_H
+
+#include "SourceFile.h"
+#include "Token.h"
+#include "AST.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "Resolver.h"
+#include "Evaluator.h"
+
+/**
+ * StreamingInterpreter - Runs a program one statement at a time.
+ *
+ * Purpose: Executes very large programs in bounded memory, with output
+ * appearing as soon as the first statement has run.
+ *
+ * How it works:
+ * A MidLang program is a flat list of ';'-terminated statements, so there
+ * is no need to see the whole program before running it. For each
+ * statement the interpreter:
+ * 1. Lexes just that statement into a reused token buffer
+ * 2. Parses it into a reused node arena
+ * 3. Resolves its variables (slots are remembered across statements)
+ * 4. Evaluates it
+ * 5. Discards its tokens and nodes
+ *
+ * Only the variable slots grow with the program; everything else is
+ * reused, and pages of the source file that have been read are handed
+ * back to the system as the interpreter moves past them.
+ *
+ * Each statement runs exactly once, so it is walked directly by the
+ * Evaluator rather than compiled to bytecode first.
+ */
+class StreamingInterpreter {
+private:
+    SourceFile& file;
+    Lexer lexer;
+    TokenBuffer tokens;
+    Parser parser;
+    ProgramNode program;
+    Resolver resolver;
+    Evaluator evaluator;
+
+public:
+    StreamingInterpreter(SourceFile& file, OutputSink& output, InputSource& input);
+
+    /**
+     * Runs every statement in order. Returns the number of statements run.
+     * Errors are thrown as in the other stages (see Errors.h).
+     */
+    size_t run();
+};
+
+#endif // STREAMING_H
@@ -0,0 +1,59 @@
+#include "Timings.h"
+#include <iomanip>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#define MIDLANG_HAVE_RUSAGE 1
+#endif
+
+PhaseTimings::PhaseTimings() : running(false) {}
+
+void PhaseTimings::start(const std::string& name) {
+    stop();
+    current = name;
+    running = true;
+    started = std::chrono::steady_clock::now();
+}
+
+void PhaseTimings::stop() {
+    if (!running) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - started).count();
+    phases.push_back(Phase{current, seconds, peakMemoryKilobytes()});
+    running = false;
+}
+
+void PhaseTimings::report(std::ostream& out) const {
+    double total = 0.0;
+    out << "Timings:" << std::endl;
+    for (const Phase& phase : phases) {
+        total += phase.seconds;
+        out << "  " << std::left << std::setw(10) << phase.name << std::right
+            << std::fixed << std::setprecision(3) << std::setw(12) << phase.seconds * 1000.0 << " ms";
+        if (phase.peakKilobytes >= 0) {
+            out << "   peak " << std::setw(10) << phase.peakKilobytes << " KB";
+        }
+        out << std::endl;
+    }
+    out << "  " << std::left << std::setw(10) << "total" << std::right
+        << std::setw(12) << total * 1000.0 << " ms" << std::endl;
+    out.unsetf(std::ios::fixed);
+}
+
+long PhaseTimings::peakMemoryKilobytes() {
+#ifdef MIDLANG_HAVE_RUSAGE
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1;
+    }
+#ifdef __APPLE__
+    return static_cast<long>(usage.ru_maxrss / 1024);  // Reported in bytes
+#else
+    return static_cast<long>(usage.ru_maxrss);         // Reported in kilobytes
+#endif
+#else
+    return -1;
+#endif
+}
@@ -0,0 +1,58 @@
+#ifndef TIMINGS_H
+#define TIMINGS_H
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * PhaseTimings - Wall time and peak memory of each interpreter phase.
+ *
+ * Purpose: Back the "--timings" option, which shows where a run spends
+ * its time (reading, lexing, parsing, evaluating) without a profiler.
+ *
+ * How it works: start() begins a phase and ends the previous one. When a
+ * phase ends, its wall time is recorded together with the process's peak
+ * resident memory so far, so a jump in the peak belongs to that phase.
+ * report() prints one line per phase.
+ */
+class PhaseTimings {
+private:
+    struct Phase {
+        std::string name;
+        double seconds;
+        long peakKilobytes;   // Peak resident memory at the end of the phase, or -1
+    };
+
+    std::vector<Phase> phases;
+    std::string current;
+    std::chrono::steady_clock::time_point started;
+    bool running;
+
+public:
+    PhaseTimings();
+
+    /**
+     * Ends the running phase, if any, and starts timing a new one.
+     */
+    void start(const std::string& name);
+
+    /**
+     * Ends the running phase, if any.
+     */
+    void stop();
+
+    /**
+     * Writes the recorded phases and their total.
+     */
+    void report(std::ostream& out) const;
+
+    /**
+     * Peak resident memory of this process in kilobytes, or -1 where the
+     * system does not report it.
+     */
+    static long peakMemoryKilobytes();
+};
+
+#endif // TIMINGS_H
@@ -1,7 +1,10 @@
 #ifndef TOKEN_H
 #define TOKEN_H
 
-#include <string>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "Interner.h"
 
 /**
  * TokenType - Types of tokens in MidLang Stage 1
@@ -34,24 +37,68 @@ enum class TokenType {
 };
 
 /**
- * Token - Represents a token in the source code.
- * 
- * Tokens are the smallest meaningful units of the language.
- * Each token has:
+ * TokenBuffer - The token stream produced by the Lexer.
+ *
+ * Tokens are stored as parallel arrays ("structure of arrays") instead of
+ * as one object per token. Each token has:
  * - A type (what kind of token it is)
- * - A value (the actual text)
+ * - Its position in the source (offset and length), instead of a copy of
+ *   its text
  * - Position information (line and column for error reporting)
+ * - The value of an integer literal, decoded once by the Lexer, or the
+ *   symbol of an identifier. A literal too big for an int gets
+ *   OUT_OF_RANGE, and the Parser reports it when it reaches it, so
+ *   errors come in source order.
+ *
+ * The buffer owns the Interner the identifiers' symbols come from. It
+ * points into the source text, so the source must outlive it.
  */
-class Token {
+class TokenBuffer {
 public:
-    TokenType type;
-    std::string value;
-    int line;
-    int column;
+    // Value of an integer literal that does not fit in an int. Literals
+    // have no sign, so no literal that fits has this value.
+    static const int32_t OUT_OF_RANGE = -1;
 
-    Token(TokenType t, const std::string& v, int l, int c)
-        : type(t), value(v), line(l), column(c) {}
+    std::string_view source;         // Text the offsets refer to
+    std::vector<TokenType> types;
+    std::vector<uint32_t> offsets;   // Start of the token in source
+    std::vector<uint32_t> lengths;   // Length of the token text
+    std::vector<uint32_t> lines;
+    std::vector<uint32_t> columns;
+    std::vector<int32_t> values;     // INTEGER: the literal's value or OUT_OF_RANGE, IDENTIFIER: its symbol, 0 otherwise
+    Interner symbols;                // Every identifier read into this buffer
+
+    size_t size() const { return types.size(); }
+
+    /**
+     * The source text of token i.
+     */
+    std::string_view text(size_t i) const {
+        return source.substr(offsets[i], lengths[i]);
+    }
+
+    /**
+     * Drops the tokens but keeps the symbols, so an identifier keeps its
+     * symbol when the buffer is refilled (see Lexer::tokenizeStatement).
+     */
+    void clear() {
+        types.clear();
+        offsets.clear();
+        lengths.clear();
+        lines.clear();
+        columns.clear();
+        values.clear();
+    }
+
+    void push(TokenType type, uint32_t offset, uint32_t length,
+              uint32_t line, uint32_t column, int32_t value = 0) {
+        types.push_back(type);
+        offsets.push_back(offset);
+        lengths.push_back(length);
+        lines.push_back(line);
+        columns.push_back(column);
+        values.push_back(value);
+    }
 };
 
 #endif // TOKEN_H
-
@@ -0,0 +1,62 @@
+#include "VM.h"
+#include "Arithmetic.h"
+#include "Errors.h"
+#include <stdexcept>
+
+VM::VM(OutputSink& output, InputSource& input)
+    : output(output), input(input) {}
+
+void VM::run(const BytecodeProgram& program) {
+    run(program.code.data(), program.slotCount, program.maxStackDepth);
+}
+
+void VM::run(const Instruction* code, size_t slotCount, size_t maxStackDepth) {
+    slots.assign(slotCount, 0);
+    stack.resize(maxStackDepth + 1);
+
+    const Instruction* ip = code;
+    int* sp = stack.data();  // points one past the top of the stack
+    int* vars = slots.data();
+
+    for (;;) {
+        const Instruction& instruction = *ip++;
+        switch (instruction.op) {
+            case OpCode::PUSH_CONST:
+                *sp++ = instruction.operand;
+                break;
+            case OpCode::LOAD_SLOT:
+                *sp++ = vars[instruction.operand];
+                break;
+            case OpCode::STORE_SLOT:
+                vars[instruction.operand] = *--sp;
+                break;
+            case OpCode::ADD:
+                sp--;
+                sp[-1] = wrapAdd(sp[-1], sp[0]);
+                break;
+            case OpCode::SUB:
+                sp--;
+                sp[-1] = wrapSub(sp[-1], sp[0]);
+                break;
+            case OpCode::MUL:
+                sp--;
+                sp[-1] = wrapMul(sp[-1], sp[0]);
+                break;
+            case OpCode::DIV:
+                sp--;
+                if (sp[0] == 0) {
+                    throw RuntimeError("Division by zero");
+                }
+                sp[-1] = sp[-1] / sp[0];
+                break;
+            case OpCode::PRINT:
+                output.writeInt(*--sp);
+                break;
+            case OpCode::INPUT_INT:
+                *sp++ = input.readInt();
+                break;
+            case OpCode::HALT:
+                return;
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef VM_H
+#define VM_H
+
+#include <vector>
+#include "Bytecode.h"
+#include "IO.h"
+
+/**
+ * VM (Stack-based virtual machine)
+ *
+ * Purpose: Executes a BytecodeProgram produced by the Compiler.
+ *
+ * How it works:
+ * 1. Walks the instruction list with an instruction pointer
+ * 2. Keeps intermediate values on an operand stack
+ * 3. Keeps variables in a flat array indexed by slot number
+ * 4. Produces exactly the same output and errors as the Evaluator
+ */
+class VM {
+private:
+    std::vector<int> slots;  // slot index -> current value
+    std::vector<int> stack;  // operand stack storage
+    OutputSink& output;
+    InputSource& input;
+
+public:
+    VM(OutputSink& output, InputSource& input);
+
+    /**
+     * Runs a program from its first instruction until HALT.
+     */
+    void run(const BytecodeProgram& program);
+
+    /**
+     * Runs instructions stored elsewhere, such as a memory-mapped
+     * ProgramCache entry. The code must end with HALT and need at most
+     * slotCount slots and maxStackDepth stack entries.
+     */
+    void run(const Instruction* code, size_t slotCount, size_t maxStackDepth);
+
+    /**
+     * Variable values (by slot) left by the last run.
+     */
+    const std::vector<int>& variables() const { return slots; }
+};
+
+#endif // VM_H
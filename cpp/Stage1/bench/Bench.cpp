@@ -0,0 +1,670 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ProgramGenerator.h"
+#include "../Lexer.h"
+#include "../Parser.h"
+#include "../Resolver.h"
+#include "../RangeAnalysis.h"
+#include "../Specializer.h"
+#include "../Optimizer.h"
+#include "../SsaOptimizer.h"
+#include "../Evaluator.h"
+#include "../Compiler.h"
+#include "../VM.h"
+#include "../JIT.h"
+#include "../ClosureEngine.h"
+#include "../MidLang.h"
+#include "../Batch.h"
+#include "../Incremental.h"
+#include "../ParallelFrontEnd.h"
+#include "../ProgramCache.h"
+#include "RecursiveParser.h"
+
+/**
+ * midlang_bench - Throughput benchmarks for each interpreter phase.
+ *
+ * Generates synthetic programs of several shapes (see ProgramGenerator),
+ * runs each phase on them several times and reports the best time, the
+ * throughput, and how many heap allocations the phase made. Results are
+ * printed as a table and written as JSON, so runs can be compared across
+ * releases.
+ *
+ * The "edit" phase times IncrementalProgram re-parsing the program after
+ * one statement is inserted in the middle, as --watch does: update()
+ * compares the whole text to find the edit. "edit (offset)" makes the
+ * same edit with edit(), at its offset, which should take about the same
+ * time for every program size.
+ *
+ * The "parse (recursive)" phase runs the old recursive descent parser
+ * (RecursiveParser) on the same tokens as a baseline for Parser, and
+ * fails if the two trees differ. It is skipped where the nesting would
+ * overflow its stack, as are the closure and JIT phases beyond the depth
+ * those engines accept.
+ *
+ * The "front end xN" phases lex and parse the source with
+ * ParallelFrontEnd on 1, 2, 4, ... threads, up to the number of cores
+ * (and at least 2) or the --threads given, in chunks small enough that
+ * every workload is split. They fail if the tree differs from the one
+ * the Lexer and Parser build. Their speed-up over one thread is printed
+ * after the table, for collecting scaling numbers on a many-core host.
+ *
+ * The "lex-avx2" (or "lex-sse2") and "lex-scalar" phases lex the source
+ * with the best scanning kernels and with the portable ones, and report
+ * bytes per second. They fail if the tokens differ from each other.
+ *
+ * The "cache load" phase loads the compiled program back from a cache
+ * directory (--cache-dir). It then changes each byte of the file's
+ * header in turn and fails if any such entry is accepted rather than
+ * left for the caller to compile from source.
+ *
+ * The "rows" workload also checks batch evaluation (--batch) against
+ * running every row on its own, with both the fastest and the portable
+ * kernels, and fails if any output differs.
+ *
+ * Usage: midlang_bench [--scale N] [--repeat N] [--workload NAME] [--threads N] [--output FILE]
+ */
+
+// ---------------------------------------------------------------------------
+// Allocation counting: every operator new in the process goes through here
+// ---------------------------------------------------------------------------
+
+// Relaxed: the counters are only read between phases, after any worker
+// threads have been joined
+static std::atomic<size_t> allocationCount{0};
+static std::atomic<size_t> allocationBytes{0};
+
+// Kept out of line: once GCC inlines them into a caller, it sees free()
+// on memory from operator new and warns (-Wmismatched-new-delete)
+#ifdef __GNUC__
+#define BENCH_NOINLINE __attribute__((noinline))
+#else
+#define BENCH_NOINLINE
+#endif
+
+BENCH_NOINLINE void* operator new(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocationBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+BENCH_NOINLINE void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+BENCH_NOINLINE void operator delete(void* p) noexcept { std::free(p); }
+BENCH_NOINLINE void operator delete[](void* p) noexcept { std::free(p); }
+BENCH_NOINLINE void operator delete(void* p, size_t) noexcept { std::free(p); }
+BENCH_NOINLINE void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+// ---------------------------------------------------------------------------
+// Measurement
+// ---------------------------------------------------------------------------
+
+struct Result {
+    std::string workload;
+    std::string phase;
+    std::string unit;         // What "items" counts: tokens, nodes, statements
+    size_t items;
+    double seconds;           // Best of all repetitions
+    size_t allocations;       // Heap allocations made by one repetition
+    size_t bytesAllocated;
+};
+
+/**
+ * Runs setup (untimed) and then run (timed) "repeat" times and keeps the
+ * fastest run.
+ */
+static Result measure(const std::string& workload, const std::string& phase, const std::string& unit,
+                      size_t items, int repeat,
+                      const std::function<void()>& setup, const std::function<void()>& run) {
+    Result result{workload, phase, unit, items, 0.0, 0, 0};
+    for (int r = 0; r < repeat; r++) {
+        setup();
+        size_t count = allocationCount.load(std::memory_order_relaxed);
+        size_t bytes = allocationBytes.load(std::memory_order_relaxed);
+        auto start = std::chrono::steady_clock::now();
+        run();
+        auto stop = std::chrono::steady_clock::now();
+
+        double seconds = std::chrono::duration<double>(stop - start).count();
+        if (r == 0 || seconds < result.seconds) {
+            result.seconds = seconds;
+        }
+        result.allocations = allocationCount.load(std::memory_order_relaxed) - count;
+        result.bytesAllocated = allocationBytes.load(std::memory_order_relaxed) - bytes;
+    }
+    return result;
+}
+
+// Deepest expression the recursive parser baseline is run on
+static const size_t RECURSIVE_PARSER_DEPTH = 5000;
+
+// Chunk size for the parallel front end phases
+static const size_t FRONT_END_CHUNK_BYTES = 64 * 1024;
+
+/**
+ * Whether two parsers built the same tree: the same nodes, in the same
+ * order, at the same source locations.
+ */
+static bool sameTree(const ProgramNode& a, const ProgramNode& b) {
+    if (a.nodes.size() != b.nodes.size() || a.statements != b.statements || a.symbols.size() != b.symbols.size()) {
+        return false;
+    }
+    for (uint32_t symbol = 0; symbol < a.symbols.size(); symbol++) {
+        if (a.symbols.name(symbol) != b.symbols.name(symbol)) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < a.nodes.size(); i++) {
+        const Node& x = a.nodes[i];
+        const Node& y = b.nodes[i];
+        if (x.kind != y.kind || x.op != y.op || x.value != y.value || x.left != y.left || x.right != y.right
+            || x.name != y.name || a.locations[i].line != b.locations[i].line
+            || a.locations[i].column != b.locations[i].column) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Whether two lexers produced the same tokens, with the same symbols.
+ */
+static bool sameTokens(const TokenBuffer& a, const TokenBuffer& b) {
+    if (a.types != b.types || a.offsets != b.offsets || a.lengths != b.lengths || a.lines != b.lines
+        || a.columns != b.columns || a.values != b.values || a.symbols.size() != b.symbols.size()) {
+        return false;
+    }
+    for (uint32_t symbol = 0; symbol < a.symbols.size(); symbol++) {
+        if (a.symbols.name(symbol) != b.symbols.name(symbol)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Runs every phase on one program. Returns false if the scanning kernels
+ * disagree, if the recursive parser baseline or the parallel front end
+ * built a different tree, or if a corrupt cache entry was loaded.
+ */
+static bool benchmarkProgram(const std::string& workload, const GeneratedProgram& generated,
+                             int repeat, unsigned maxThreads, std::vector<Result>& results) {
+    const std::string& source = generated.source;
+    std::ostream discard(nullptr);  // Program output goes nowhere
+
+    // Lexing
+    TokenBuffer tokens;
+    results.push_back(measure(workload, "lex", "tokens", 0, repeat, [] {}, [&] {
+        Lexer lexer(source);
+        tokens = lexer.tokenize();
+    }));
+    results.back().items = tokens.size();
+
+    // Lexing with the best scanning kernels and with the portable ones
+    const ScanKernels* scanSets[] = {&selectScanKernels(), &scalarScanKernels()};
+    for (const ScanKernels* scan : scanSets) {
+        TokenBuffer scanned;
+        std::string phase = std::string("lex-") + scan->name;
+        results.push_back(measure(workload, phase, "bytes", source.size(), repeat, [] {}, [&] {
+            Lexer lexer(source, *scan);
+            scanned = lexer.tokenize();
+        }));
+        if (!sameTokens(tokens, scanned)) {
+            std::cerr << "Error: " << workload << ": " << phase << " produced different tokens" << std::endl;
+            return false;
+        }
+    }
+
+    // Parsing
+    std::unique_ptr<ProgramNode> ast;
+    results.push_back(measure(workload, "parse", "nodes", 0, repeat, [&] { ast.reset(); }, [&] {
+        Parser parser(tokens);
+        ast = parser.parse();
+    }));
+    results.back().items = ast->nodes.size();
+    size_t statements = ast->statements.size();
+
+    TreeWalker walker;
+    size_t depth = walker.height(*ast);
+    if (depth <= RECURSIVE_PARSER_DEPTH) {
+        std::unique_ptr<ProgramNode> baseline;
+        results.push_back(measure(workload, "parse (recursive)", "nodes", ast->nodes.size(), repeat,
+                                  [&] { baseline.reset(); }, [&] {
+            RecursiveParser parser(tokens);
+            baseline = parser.parse();
+        }));
+        if (!sameTree(*ast, *baseline)) {
+            std::cerr << "Error: " << workload << ": the recursive parser built a different tree" << std::endl;
+            return false;
+        }
+    }
+
+    // Lexing and parsing together, on more and more threads
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        std::unique_ptr<ProgramNode> parallel;
+        results.push_back(measure(workload, "front end x" + std::to_string(threads), "bytes", source.size(), repeat,
+                                  [&] { parallel.reset(); }, [&] {
+            ParallelFrontEnd frontEnd(threads, FRONT_END_CHUNK_BYTES);
+            parallel = frontEnd.parse(source);
+        }));
+        if (!sameTree(*ast, *parallel)) {
+            std::cerr << "Error: " << workload << ": the parallel front end built a different tree on "
+                      << threads << " thread(s)" << std::endl;
+            return false;
+        }
+    }
+
+    // Resolving
+    results.push_back(measure(workload, "resolve", "nodes", ast->nodes.size(), repeat, [] {}, [&] {
+        Resolver resolver;
+        resolver.resolve(ast.get());
+    }));
+
+    // Value ranges. This also marks the divisions that the later phases
+    // run without a zero check.
+    results.push_back(measure(workload, "analyze", "nodes", ast->nodes.size(), repeat, [] {}, [&] {
+        RangeAnalysis ranges;
+        ranges.analyze(ast.get());
+    }));
+
+    // Partial evaluation into a residual program (--specialize)
+    std::stringstream residual;
+    results.push_back(measure(workload, "specialize", "nodes", ast->nodes.size(), repeat,
+                              [&] { residual.str(""); }, [&] {
+        Specializer specializer;
+        specializer.specialize(*ast, residual);
+    }));
+
+    // Optimizing (on a fresh copy each time, since it rewrites the tree)
+    ProgramNode optimized;
+    results.push_back(measure(workload, "optimize", "nodes", ast->nodes.size(), repeat,
+                              [&] { optimized = *ast; }, [&] {
+        Optimizer optimizer;
+        optimizer.optimize(&optimized);
+    }));
+
+    // Dead store and common subexpression elimination on the optimized tree
+    ProgramNode rewritten;
+    results.push_back(measure(workload, "ssa", "nodes", optimized.nodes.size(), repeat,
+                              [&] { rewritten = optimized; }, [&] {
+        SsaOptimizer ssa;
+        ssa.optimize(&rewritten);
+    }));
+
+    // Re-parsing after a one-statement edit in the middle: found by
+    // comparing the texts (--watch), and given at its offset, which should
+    // cost about the same for every program size
+    IncrementalProgram incremental;
+    incremental.update(source);
+    size_t middle = source.find('\n', source.size() / 2) + 1;
+    std::string statement = "print(12345);\n";
+    std::string edited = source.substr(0, middle) + statement + source.substr(middle);
+    results.push_back(measure(workload, "edit", "edits", 1, repeat, [&] { incremental.update(source); }, [&] {
+        incremental.update(edited);
+    }));
+    results.push_back(measure(workload, "edit (offset)", "edits", 1, repeat, [&] { incremental.update(source); }, [&] {
+        incremental.edit(middle, 0, statement);
+    }));
+
+    // Tree-walking evaluation
+    std::unique_ptr<InputSource> input;
+    results.push_back(measure(workload, "evaluate", "statements", statements, repeat,
+                              [&] { input = std::make_unique<InputSource>(generated.input); }, [&] {
+        OutputSink output(discard);
+        Evaluator evaluator(output, *input);
+        evaluator.evaluate(ast.get());
+    }));
+
+    // Bytecode compilation and VM execution
+    BytecodeProgram bytecode;
+    results.push_back(measure(workload, "compile", "nodes", ast->nodes.size(), repeat, [] {}, [&] {
+        Compiler compiler;
+        bytecode = compiler.compile(ast.get());
+    }));
+    results.push_back(measure(workload, "vm", "statements", statements, repeat,
+                              [&] { input = std::make_unique<InputSource>(generated.input); }, [&] {
+        OutputSink output(discard);
+        VM vm(output, *input);
+        vm.run(bytecode);
+    }));
+
+    // Loading the bytecode back from the cache, then the same with each
+    // header byte corrupted in turn, which must never be loaded
+    std::filesystem::path cacheDirectory = std::filesystem::temp_directory_path() / ("midlang_bench_" + workload);
+    std::filesystem::remove_all(cacheDirectory);
+    ProgramCache cache(cacheDirectory.string());
+    cache.store(source, 0, bytecode);
+    bool loaded = false;
+    results.push_back(measure(workload, "cache load", "instructions", bytecode.code.size(), repeat, [] {}, [&] {
+        CachedProgram cached;
+        loaded = cache.load(source, 0, cached);
+    }));
+    std::filesystem::path entry = std::filesystem::directory_iterator(cacheDirectory)->path();
+    std::string intact;
+    {
+        std::ifstream in(entry, std::ios::binary);
+        intact.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    size_t acceptedByte = intact.size();
+    for (size_t byte = 0; loaded && byte < 64 && acceptedByte == intact.size(); byte++) {
+        std::string corrupt = intact;
+        corrupt[byte] = static_cast<char>(corrupt[byte] ^ 0xFF);
+        std::ofstream(entry, std::ios::binary | std::ios::trunc).write(corrupt.data(),
+                                                                       static_cast<std::streamsize>(corrupt.size()));
+        CachedProgram cached;
+        if (cache.load(source, 0, cached)) {
+            acceptedByte = byte;
+        }
+    }
+    std::filesystem::remove_all(cacheDirectory);
+    if (!loaded) {
+        std::cerr << "Error: " << workload << ": the cached program could not be loaded back" << std::endl;
+        return false;
+    }
+    if (acceptedByte != intact.size()) {
+        std::cerr << "Error: " << workload << ": a cache entry with header byte " << acceptedByte
+                  << " corrupted was loaded" << std::endl;
+        return false;
+    }
+
+    // Pre-specialized closures, built once and run on fresh input
+    if (depth <= ClosureEngine::MAX_DEPTH) {
+        OutputSink closureOutput(discard);
+        InputSource closureInput([&] { return input->readInt(); });
+        ClosureEngine closures(closureOutput, closureInput);
+        results.push_back(measure(workload, "closure build", "nodes", ast->nodes.size(), repeat, [] {}, [&] {
+            closures.compile(*ast);
+        }));
+        results.push_back(measure(workload, "closure", "statements", statements, repeat,
+                                  [&] { input = std::make_unique<InputSource>(generated.input); }, [&] {
+            closures.run();
+        }));
+    }
+
+    // Native code, where this host supports it. The code is generated
+    // once; each run reads the fresh input through a callback.
+    if (JIT::isSupported() && depth <= JIT::MAX_DEPTH) {
+        OutputSink jitOutput(discard);
+        InputSource jitInput([&] { return input->readInt(); });
+        JIT jit(jitOutput, jitInput);
+        results.push_back(measure(workload, "jit compile", "nodes", ast->nodes.size(), repeat, [] {}, [&] {
+            jit.compile(*ast);
+        }));
+        results.push_back(measure(workload, "jit", "statements", statements, repeat,
+                                  [&] { input = std::make_unique<InputSource>(generated.input); }, [&] {
+            jit.run();
+        }));
+    }
+
+    // The same program through the embedding API: compiled once, then run
+    // in a Session with input and output callbacks (unoptimized, like the
+    // tree the other phases run)
+    midlang::CompileOptions options;
+    options.optimize = false;
+    std::shared_ptr<const midlang::Program> compiled = midlang::Program::compile(source, options);
+    midlang::Session session(compiled);
+    int64_t checksum = 0;
+    session.setOutput([&](int value) { checksum += value; });
+    session.setInput([&] { return input->readInt(); });
+    results.push_back(measure(workload, "session", "statements", statements, repeat,
+                              [&] { input = std::make_unique<InputSource>(generated.input); }, [&] {
+        session.run();
+    }));
+    return true;
+}
+
+/**
+ * Splits CSV text into rows of cells.
+ */
+static std::vector<std::vector<std::string>> splitRows(const std::string& text) {
+    std::vector<std::vector<std::string>> rows;
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::vector<std::string> cells;
+        std::string cell;
+        std::istringstream cellStream(line);
+        while (std::getline(cellStream, cell, ',')) {
+            cells.push_back(cell);
+        }
+        rows.push_back(cells);
+    }
+    return rows;
+}
+
+/**
+ * Drops the " at line L, column C" that batch error messages end with,
+ * since a normal run's errors do not say where they happened.
+ */
+static std::string withoutLocation(const std::string& line) {
+    size_t at = line.rfind(" at line ");
+    if (at == std::string::npos) {
+        return line;
+    }
+    return line.substr(0, at) + "\"";
+}
+
+/**
+ * Benchmarks --batch on the "rows" workload against one Session run per
+ * row, and checks that all of them print the same. Returns false if not.
+ */
+static bool benchmarkBatch(const GeneratedProgram& generated, int repeat, std::vector<Result>& results) {
+    Lexer lexer(generated.source);
+    TokenBuffer tokens = lexer.tokenize();
+    Parser parser(tokens);
+    std::unique_ptr<ProgramNode> ast = parser.parse();
+    Resolver resolver;
+    resolver.resolve(ast.get());
+    std::vector<std::vector<std::string>> rows = splitRows(generated.input);
+
+    // One run per row through the embedding API, the way a service would
+    std::string expected;
+    midlang::Session session(midlang::Program::compile(generated.source));
+    const std::vector<std::string>* cells = nullptr;
+    size_t nextCell = 0;
+    std::string printed;
+    session.setInput([&] {
+        const std::string& cell = (nextCell < cells->size()) ? (*cells)[nextCell] : std::string();
+        nextCell++;
+        int value;
+        if (!parseInteger(cell.data(), cell.data() + cell.size(), value)) {
+            throw RuntimeError("Invalid integer input: " + cell);
+        }
+        return value;
+    });
+    session.setOutput([&](int value) { printed += std::to_string(value) + ","; });
+    results.push_back(measure("rows", "session", "rows", rows.size(), repeat, [&] { expected.clear(); }, [&] {
+        for (const std::vector<std::string>& row : rows) {
+            cells = &row;
+            nextCell = 0;
+            printed.clear();
+            std::string error;
+            try {
+                session.run();
+            } catch (const std::exception& ex) {
+                error = std::string("\"") + ex.what() + "\"";
+            }
+            // Pad with empty cells for the prints that did not run
+            size_t columns = 0;
+            for (char c : printed) columns += (c == ',');
+            for (; columns < 4; columns++) printed += ",";
+            expected += printed + error + "\n";
+        }
+    }));
+
+    // Batch evaluation, with the best kernels and with the portable ones
+    const SimdKernels* kernelSets[] = {&selectKernels(), &scalarKernels()};
+    for (const SimdKernels* kernels : kernelSets) {
+        std::ostringstream out;
+        std::string phase = std::string("batch-") + kernels->name;
+        results.push_back(measure("rows", phase, "rows", rows.size(), repeat,
+                                  [&] { out.str(""); }, [&] {
+            BatchEvaluator evaluator(*ast, *kernels);
+            evaluator.run(generated.input, out);
+        }));
+
+        std::istringstream lines(out.str());
+        std::string line;
+        std::getline(lines, line);  // Header
+        std::string actual;
+        while (std::getline(lines, line)) {
+            actual += withoutLocation(line) + "\n";
+        }
+        if (actual != expected) {
+            std::cerr << "Error: " << phase << " output differs from running each row" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+static void writeJson(std::ostream& out, const std::vector<Result>& results, size_t scale, int repeat) {
+    out << "{\n";
+    out << "  \"schema\": 1,\n";
+    out << "  \"scale\": " << scale << ",\n";
+    out << "  \"repeat\": " << repeat << ",\n";
+    out << "  \"cores\": " << std::thread::hardware_concurrency() << ",\n";
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        double throughput = r.seconds > 0 ? static_cast<double>(r.items) / r.seconds : 0.0;
+        out << "    {\"workload\": \"" << r.workload << "\", \"phase\": \"" << r.phase
+            << "\", \"unit\": \"" << r.unit << "\", \"items\": " << r.items
+            << ", \"seconds\": " << std::setprecision(9) << r.seconds
+            << ", \"items_per_second\": " << std::setprecision(6) << throughput
+            << ", \"allocations\": " << r.allocations
+            << ", \"bytes_allocated\": " << r.bytesAllocated << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+static void writeTable(std::ostream& out, const std::vector<Result>& results) {
+    out << std::left << std::setw(12) << "workload" << std::setw(14) << "phase"
+        << std::right << std::setw(12) << "items" << std::setw(12) << "ms"
+        << std::setw(16) << "items/s" << std::setw(12) << "allocs" << "\n";
+    for (const Result& r : results) {
+        double throughput = r.seconds > 0 ? static_cast<double>(r.items) / r.seconds : 0.0;
+        out << std::left << std::setw(12) << r.workload << std::setw(14) << r.phase
+            << std::right << std::setw(12) << r.items
+            << std::setw(12) << std::fixed << std::setprecision(2) << r.seconds * 1000.0
+            << std::setw(16) << std::setprecision(0) << throughput
+            << std::setw(12) << r.allocations << " " << r.unit << "\n";
+        out.unsetf(std::ios::fixed);
+    }
+}
+
+/**
+ * Prints, for each workload, how much faster the "front end xN" phases
+ * ran than "front end x1".
+ */
+static void writeScaling(std::ostream& out, const std::vector<Result>& results) {
+    static const std::string PREFIX = "front end x";
+    out << "Front end speed-up over 1 thread (" << std::thread::hardware_concurrency() << " core(s)):";
+    const Result* single = nullptr;
+    for (const Result& r : results) {
+        if (r.phase == PREFIX + "1") {
+            single = &r;
+            out << "\n  " << std::left << std::setw(12) << r.workload << std::right;
+        } else if (single != nullptr && r.workload == single->workload && r.phase.rfind(PREFIX, 0) == 0
+                   && r.seconds > 0) {
+            out << "  x" << r.phase.substr(PREFIX.size()) << " " << std::fixed << std::setprecision(2)
+                << single->seconds / r.seconds;
+            out.unsetf(std::ios::fixed);
+        }
+    }
+    out << "\n";
+}
+
+int main(int argc, char* argv[]) {
+    size_t scale = 1;
+    int repeat = 3;
+    std::string only;
+    std::string outputFile = "midlang_bench.json";
+    unsigned maxThreads = std::max(2u, std::thread::hardware_concurrency());
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--scale" && i + 1 < argc) {
+            scale = std::stoul(argv[++i]);
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            repeat = std::stoi(argv[++i]);
+        } else if (arg == "--workload" && i + 1 < argc) {
+            only = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            maxThreads = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg == "--output" && i + 1 < argc) {
+            outputFile = argv[++i];
+        } else {
+            std::cerr << "Usage: midlang_bench [--scale N] [--repeat N] [--workload NAME] [--threads N] [--output FILE]"
+                      << std::endl;
+            return 1;
+        }
+    }
+    if (scale == 0 || repeat <= 0 || maxThreads == 0) {
+        std::cerr << "Error: --scale, --repeat and --threads must be positive" << std::endl;
+        return 1;
+    }
+
+    // Workload sizes at --scale 1 take a few tenths of a second per phase
+    ProgramGenerator generator;
+    std::vector<std::pair<std::string, std::function<GeneratedProgram()>>> workloads = {
+        {"statements", [&] { return generator.statements(100000 * scale); }},
+        {"nested", [&] { return generator.nested(500 * scale, 200); }},
+        {"deep", [&] { return generator.nested(2 * scale, 50000, true); }},
+        {"wide", [&] { return generator.wide(50 * scale, 2000); }},
+        {"variables", [&] { return generator.variables(100000 * scale); }},
+        {"input", [&] { return generator.input(50000 * scale); }},
+    };
+
+    std::vector<Result> results;
+    for (auto& workload : workloads) {
+        if (!only.empty() && workload.first != only) {
+            continue;
+        }
+        std::cerr << "Running " << workload.first << "..." << std::endl;
+        if (!benchmarkProgram(workload.first, workload.second(), repeat, maxThreads, results)) {
+            return 1;
+        }
+    }
+    if (only.empty() || only == "rows") {
+        std::cerr << "Running rows..." << std::endl;
+        if (!benchmarkBatch(generator.rows(200000 * scale), repeat, results)) {
+            return 1;
+        }
+    }
+    if (results.empty()) {
+        std::cerr << "Error: Unknown workload: " << only << std::endl;
+        return 1;
+    }
+
+    writeTable(std::cout, results);
+    writeScaling(std::cout, results);
+
+    std::ofstream json(outputFile);
+    if (!json.is_open()) {
+        std::cerr << "Error: Cannot write " << outputFile << std::endl;
+        return 1;
+    }
+    writeJson(json, results, scale, repeat);
+    std::cout << "Results written to " << outputFile << std::endl;
+    return 0;
+}
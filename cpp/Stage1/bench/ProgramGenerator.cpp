@@ -0,0 +1,137 @@
+#include "ProgramGenerator.h"
+
+// Number of variables shared by the statement-heavy shapes
+static const int32_t SMALL_VARIABLES = 8;
+
+ProgramGenerator::ProgramGenerator(uint32_t seed) : random(seed) {}
+
+int32_t ProgramGenerator::pick(int32_t low, int32_t high) {
+    return std::uniform_int_distribution<int32_t>(low, high)(random);
+}
+
+std::string ProgramGenerator::variable(int32_t index) {
+    return "v" + std::to_string(index);
+}
+
+GeneratedProgram ProgramGenerator::statements(size_t count) {
+    GeneratedProgram program;
+    for (int32_t i = 0; i < SMALL_VARIABLES; i++) {
+        program.source += "var " + variable(i) + " = " + std::to_string(pick(1, 100)) + ";\n";
+    }
+
+    // Every divisor is a non-zero literal, so no statement can fail
+    for (size_t i = 0; i < count; i++) {
+        std::string target = variable(pick(0, SMALL_VARIABLES - 1));
+        std::string a = variable(pick(0, SMALL_VARIABLES - 1));
+        std::string b = variable(pick(0, SMALL_VARIABLES - 1));
+        switch (pick(0, 3)) {
+            case 0:
+                program.source += target + " = " + a + " + " + std::to_string(pick(1, 9)) + " - " + b + " / 3;\n";
+                break;
+            case 1:
+                program.source += target + " = (" + a + " * " + std::to_string(pick(2, 5)) + ") / 4 + 1;\n";
+                break;
+            case 2:
+                program.source += target + " = " + a + " - " + b + " * 2 + 7;\n";
+                break;
+            default:
+                program.source += "print(" + a + " + " + b + ");\n";
+                break;
+        }
+        // Keep values from drifting towards overflow
+        if (i % 16 == 15) {
+            program.source += target + " = " + target + " / 1000;\n";
+        }
+    }
+    return program;
+}
+
+GeneratedProgram ProgramGenerator::nested(size_t statementCount, size_t depth, bool splitChains) {
+    GeneratedProgram program;
+    program.source += "var x = 1;\n";
+
+    for (size_t i = 0; i < statementCount; i++) {
+        std::string expression = "x";
+        std::string open;
+        std::string close;
+        for (size_t d = 0; d < depth; d++) {
+            open += "(";
+            if (splitChains && i % 2 == 1) {
+                close += " / 1 + x)";
+            } else {
+                close += (d % 2 == 0) ? " + 1)" : " - 1)";
+            }
+        }
+        program.source += "x = " + open + expression + close + " / 2;\n";
+    }
+    program.source += "print(x);\n";
+    return program;
+}
+
+GeneratedProgram ProgramGenerator::wide(size_t statementCount, size_t width) {
+    GeneratedProgram program;
+    for (int32_t i = 0; i < SMALL_VARIABLES; i++) {
+        program.source += "var " + variable(i) + " = " + std::to_string(pick(1, 9)) + ";\n";
+    }
+
+    static const char* const operators[] = {" + ", " - ", " * ", " / "};
+    for (size_t i = 0; i < statementCount; i++) {
+        std::string line = "print(" + variable(pick(0, SMALL_VARIABLES - 1));
+        for (size_t w = 0; w < width; w++) {
+            // Products and quotients only ever use literals 1..3
+            int32_t op = pick(0, 3);
+            line += operators[op];
+            line += (op >= 2) ? std::to_string(pick(1, 3)) : variable(pick(0, SMALL_VARIABLES - 1));
+        }
+        program.source += line + ");\n";
+    }
+    return program;
+}
+
+GeneratedProgram ProgramGenerator::variables(size_t count) {
+    GeneratedProgram program;
+    program.source += "var " + variable(0) + " = 1;\n";
+    for (size_t i = 1; i < count; i++) {
+        int32_t previous = pick(0, static_cast<int32_t>(i) - 1);
+        program.source += "var " + variable(static_cast<int32_t>(i)) + " = " + variable(previous) + " / 2 + "
+                          + std::to_string(pick(1, 1000)) + ";\n";
+    }
+    program.source += "print(" + variable(static_cast<int32_t>(count) - 1) + ");\n";
+    return program;
+}
+
+GeneratedProgram ProgramGenerator::input(size_t count) {
+    GeneratedProgram program;
+    program.source += "var total = 0;\n";
+    for (size_t i = 0; i < count; i++) {
+        program.source += "var x = inputInt();\n";
+        program.source += "total = total / 2 + x;\n";
+        program.source += "print(x * 2 - total);\n";
+        program.input += std::to_string(pick(-100000, 100000)) + "\n";
+    }
+    return program;
+}
+
+GeneratedProgram ProgramGenerator::rows(size_t count) {
+    GeneratedProgram program;
+    program.source =
+        "var a = inputInt();\n"
+        "var b = inputInt();\n"
+        "var c = inputInt();\n"
+        "var s = a + b * c;\n"
+        "print(s);\n"
+        "var q = s / (b - 3);\n"
+        "print(q - a * 7);\n"
+        "var r = (a - c) * (b + 2) / 5;\n"
+        "print(r + q);\n"
+        "print(inputInt() / (c + 1));\n";
+
+    // b == 3 and c == -1 divide by zero; a few cells are not numbers
+    for (size_t i = 0; i < count; i++) {
+        std::string row = std::to_string(pick(-10, 10)) + "," + std::to_string(pick(-10, 10)) + ","
+                          + std::to_string(pick(-10, 10)) + ",";
+        row += (pick(0, 99) == 0) ? "x" : std::to_string(pick(-100000, 100000));
+        program.input += row + "\n";
+    }
+    return program;
+}
@@ -0,0 +1,51 @@
+#ifndef PROGRAM_GENERATOR_H
+#define PROGRAM_GENERATOR_H
+
+#include <cstdint>
+#include <random>
+#include <string>
+
+/**
+ * GeneratedProgram - Source text of a synthetic program, plus the text to
+ * feed its inputInt() calls.
+ */
+struct GeneratedProgram {
+    std::string source;
+    std::string input;
+};
+
+/**
+ * ProgramGenerator - Builds synthetic MidLang programs of any size.
+ *
+ * Every program is valid, deterministic for a given seed, and never
+ * divides by zero, so it runs to completion on every engine. Each shape
+ * stresses a different part of the interpreter:
+ * - statements:    many short statements over a few variables
+ * - nested:        deeply parenthesized expressions; with splitChains,
+ *                  every other one is ((x / 1 + x) / 1 + x) ..., one
+ *                  long sum once the Optimizer drops the divisions
+ * - wide:          very long expressions with many operators
+ * - variables:     many distinct variables
+ * - input:         programs dominated by inputInt() and print
+ * - rows:          one small program plus many rows of CSV input for
+ *                  batch evaluation (--batch), some of which fail
+ */
+class ProgramGenerator {
+private:
+    std::mt19937 random;
+
+    int32_t pick(int32_t low, int32_t high);
+    std::string variable(int32_t index);
+
+public:
+    ProgramGenerator(uint32_t seed = 42);
+
+    GeneratedProgram statements(size_t count);
+    GeneratedProgram nested(size_t statementCount, size_t depth, bool splitChains = false);
+    GeneratedProgram wide(size_t statementCount, size_t width);
+    GeneratedProgram variables(size_t count);
+    GeneratedProgram input(size_t count);
+    GeneratedProgram rows(size_t count);
+};
+
+#endif // PROGRAM_GENERATOR_H
@@ -0,0 +1,179 @@
+#include "RecursiveParser.h"
+#include "../Errors.h"
+#include <sstream>
+
+RecursiveParser::RecursiveParser(const TokenBuffer& tokens)
+    : tokens(tokens), current(0), program(nullptr) {}
+
+std::unique_ptr<ProgramNode> RecursiveParser::parse() {
+    auto result = std::make_unique<ProgramNode>();
+    program = result.get();
+    current = 0;
+
+    // Every node consumes at least one token, so this single reservation
+    // is enough for the whole tree and the arena never has to grow.
+    program->nodes.reserve(tokens.size());
+    program->locations.reserve(tokens.size());
+    program->symbols = tokens.symbols;
+
+    while (!isAtEnd()) {
+        program->statements.push_back(parseStatement());
+    }
+
+    program = nullptr;
+    return result;
+}
+
+NodeIndex RecursiveParser::parseStatement() {
+    if (match(TokenType::VAR)) {
+        return parseVarDeclaration();
+    } else if (match(TokenType::PRINT)) {
+        return parsePrintStatement();
+    } else {
+        return parseAssignmentStatement();
+    }
+}
+
+NodeIndex RecursiveParser::parseVarDeclaration() {
+    SourceLocation location = locationOf(previous());
+    size_t identifier = consume(TokenType::IDENTIFIER, "Expected variable name after 'var'");
+    consume(TokenType::ASSIGN, "Expected '=' after variable name");
+    auto expression = parseExpression();
+    consume(TokenType::SEMICOLON, "Expected ';' after expression");
+
+    uint32_t name = static_cast<uint32_t>(tokens.values[identifier]);
+    return program->add(Node::statement(NodeKind::VAR_DECLARATION, expression, name), location);
+}
+
+NodeIndex RecursiveParser::parseAssignmentStatement() {
+    size_t identifier = consume(TokenType::IDENTIFIER, "Expected variable name");
+    consume(TokenType::ASSIGN, "Expected '=' after variable name");
+    auto expression = parseExpression();
+    consume(TokenType::SEMICOLON, "Expected ';' after expression");
+
+    uint32_t name = static_cast<uint32_t>(tokens.values[identifier]);
+    return program->add(Node::statement(NodeKind::ASSIGNMENT, expression, name), locationOf(identifier));
+}
+
+NodeIndex RecursiveParser::parsePrintStatement() {
+    SourceLocation location = locationOf(previous());
+    consume(TokenType::LEFT_PAREN, "Expected '(' after 'print'");
+    auto expression = parseExpression();
+    consume(TokenType::RIGHT_PAREN, "Expected ')' after expression");
+    consume(TokenType::SEMICOLON, "Expected ';' after ')'");
+
+    return program->add(Node::statement(NodeKind::PRINT, expression), location);
+}
+
+NodeIndex RecursiveParser::parseExpression() {
+    auto expr = parseTerm();
+
+    while (match(TokenType::PLUS) || match(TokenType::MINUS)) {
+        size_t opToken = previous();
+        BinaryOp op = tokens.types[opToken] == TokenType::PLUS ? BinaryOp::ADD : BinaryOp::SUBTRACT;
+        auto right = parseTerm();
+        expr = program->add(Node::binaryExpression(expr, op, right), locationOf(opToken));
+    }
+
+    return expr;
+}
+
+NodeIndex RecursiveParser::parseTerm() {
+    auto expr = parseFactor();
+
+    while (match(TokenType::MULTIPLY) || match(TokenType::DIVIDE)) {
+        size_t opToken = previous();
+        BinaryOp op = tokens.types[opToken] == TokenType::MULTIPLY ? BinaryOp::MULTIPLY : BinaryOp::DIVIDE;
+        auto right = parseFactor();
+        expr = program->add(Node::binaryExpression(expr, op, right), locationOf(opToken));
+    }
+
+    return expr;
+}
+
+NodeIndex RecursiveParser::parseFactor() {
+    if (match(TokenType::INTEGER)) {
+        int value = tokens.values[previous()];
+        return program->add(Node::integerLiteral(value), locationOf(previous()));
+    }
+
+    if (match(TokenType::INPUT_INT)) {
+        SourceLocation location = locationOf(previous());
+        consume(TokenType::LEFT_PAREN, "Expected '(' after 'inputInt'");
+        consume(TokenType::RIGHT_PAREN, "Expected ')' after '('");
+        return program->add(Node::inputInt(), location);
+    }
+
+    if (match(TokenType::IDENTIFIER)) {
+        size_t identifier = previous();
+        uint32_t name = static_cast<uint32_t>(tokens.values[identifier]);
+        return program->add(Node::variableReference(name), locationOf(identifier));
+    }
+
+    if (match(TokenType::LEFT_PAREN)) {
+        auto expr = parseExpression();
+        consume(TokenType::RIGHT_PAREN, "Expected ')' after expression");
+        return expr;
+    }
+
+    std::stringstream ss;
+    ss << "Unexpected token: " << static_cast<int>(peek())
+       << " at line " << tokens.lines[current] << ", column " << tokens.columns[current];
+    fail(ss.str());
+}
+
+bool RecursiveParser::match(TokenType type) {
+    if (check(type)) {
+        advance();
+        return true;
+    }
+    return false;
+}
+
+bool RecursiveParser::match(TokenType type1, TokenType type2) {
+    return match(type1) || match(type2);
+}
+
+bool RecursiveParser::check(TokenType type) {
+    if (isAtEnd()) return false;
+    return peek() == type;
+}
+
+size_t RecursiveParser::advance() {
+    if (!isAtEnd()) current++;
+    return previous();
+}
+
+bool RecursiveParser::isAtEnd() {
+    return peek() == TokenType::EOF_TOKEN;
+}
+
+TokenType RecursiveParser::peek() {
+    return tokens.types[current];
+}
+
+size_t RecursiveParser::previous() {
+    return current - 1;
+}
+
+SourceLocation RecursiveParser::locationOf(size_t token) {
+    return SourceLocation{tokens.lines[token], tokens.columns[token]};
+}
+
+size_t RecursiveParser::consume(TokenType type, const char* message) {
+    if (check(type)) return advance();
+
+    std::stringstream ss;
+    ss << message << " at line " << tokens.lines[current] << ", column " << tokens.columns[current]
+       << ". Found: " << static_cast<int>(peek());
+    fail(ss.str());
+}
+
+void RecursiveParser::fail(const std::string& message) {
+    // The lexer stops at a character it does not recognize, so the parser
+    // is the first to reach it. Report that as a lexical error.
+    if (peek() == TokenType::UNKNOWN) {
+        throw LexError(message);
+    }
+    throw ParseError(message);
+}
@@ -0,0 +1,61 @@
+#ifndef RECURSIVE_PARSER_H
+#define RECURSIVE_PARSER_H
+
+#include <memory>
+#include <string>
+#include "../Token.h"
+#include "../AST.h"
+
+/**
+ * RecursiveParser - The recursive descent parser MidLang used before
+ * Parser switched to explicit operator stacks, kept as a benchmark
+ * baseline.
+ *
+ * It builds exactly the same tree as Parser, but uses one C++ stack frame
+ * per level of nesting (three per parenthesis), so deeply nested input
+ * overflows the stack. midlang_bench only runs it on inputs shallow
+ * enough to be safe.
+ *
+ * Grammar:
+ * Expression = Term { ("+" | "-") Term }
+ * Term = Factor { ("*" | "/") Factor }
+ * Factor = INTEGER | inputInt() | Identifier | "(" Expression ")"
+ */
+class RecursiveParser {
+private:
+    const TokenBuffer& tokens;  // Not owned: must outlive the parser
+    size_t current;             // Index of the next token
+    ProgramNode* program;       // Program being built
+
+    // Helper methods
+    bool match(TokenType type);
+    bool match(TokenType type1, TokenType type2);
+    bool check(TokenType type);
+    size_t advance();
+    bool isAtEnd();
+    TokenType peek();
+    size_t previous();
+    size_t consume(TokenType type, const char* message);
+    SourceLocation locationOf(size_t token);
+    [[noreturn]] void fail(const std::string& message);
+
+    // Parsing methods
+    NodeIndex parseStatement();
+    NodeIndex parseVarDeclaration();
+    NodeIndex parseAssignmentStatement();
+    NodeIndex parsePrintStatement();
+    NodeIndex parseExpression();
+    NodeIndex parseTerm();
+    NodeIndex parseFactor();
+
+public:
+    RecursiveParser(const TokenBuffer& tokens);
+    
+    /**
+     * Parses the token stream and returns a Program AST node.
+     */
+    std::unique_ptr<ProgramNode> parse();
+};
+
+#endif // RECURSIVE_PARSER_H
+
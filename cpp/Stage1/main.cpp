@@ -1,10 +1,32 @@
-#include <iostream>
+#include <chrono>
+#include <filesystem>
 #include <fstream>
+#include <iostream>
 #include <sstream>
 #include <stdexcept>
+#include <thread>
+#include "Errors.h"
+#include "SourceFile.h"
 #include "Lexer.h"
 #include "Parser.h"
+#include "Resolver.h"
+#include "RangeAnalysis.h"
+#include "Optimizer.h"
+#include "SsaOptimizer.h"
 #include "Evaluator.h"
+#include "Compiler.h"
+#include "VM.h"
+#include "JIT.h"
+#include "CEmitter.h"
+#include "Specializer.h"
+#include "ClosureEngine.h"
+#include "Streaming.h"
+#include "Timings.h"
+#include "Profile.h"
+#include "ProgramCache.h"
+#include "Batch.h"
+#include "Incremental.h"
+#include "ParallelFrontEnd.h"
 
 /**
  * Main entry point for the MidLang Stage 1 interpreter.
@@ -13,81 +35,639 @@
  * 1. Lexer: Converts source code to tokens
  * 2. Parser: Builds AST from tokens
  * 3. Evaluator: Executes AST
+ *
+ * By default the AST is compiled to bytecode and run on the stack VM.
+ * "--engine=tree" selects the tree-walking Evaluator, which is kept as
+ * the reference implementation. "--engine=jit" compiles the AST to
+ * x86-64 machine code (see JIT); on any other host it falls back to the
+ * Evaluator. "--engine=closure" turns the AST into pre-specialized
+ * closures once and runs those (see ClosureEngine).
+ *
+ * The AST is simplified by the Optimizer before it runs, then the
+ * SsaOptimizer removes dead stores and repeated expressions;
+ * "--no-ssa" skips the second step and "--no-optimize" skips both.
+ *
+ * "--stream" runs the program one statement at a time as it is read,
+ * in bounded memory and without the stage-by-stage dump.
+ *
+ * For the tree, closure and JIT engines, RangeAnalysis works out after
+ * name resolution which values every expression can take, and they
+ * leave out the zero check of divisions whose divisor can never be zero.
+ * "--warnings" runs it for any engine and lists, on stderr, every
+ * division that might fail and every +, - and * that might wrap around,
+ * with its line and column.
+ *
+ * "--threads=N" lexes and parses large sources on N threads (0 for one
+ * per core; see ParallelFrontEnd). The stage-by-stage dump then gives
+ * the number of tokens but does not list them.
+ *
+ * "--verbose" (the default) prints every stage as it runs. "--quiet"
+ * prints only the program's own output, for scripts. "--timings" adds
+ * the wall time and peak memory of each phase on stderr.
+ *
+ * "--profile=FILE" runs the program on the tree-walking Evaluator with
+ * profiling on and writes per-statement counts and times, by source
+ * line and column, to FILE as JSON. "--profile-folded=FILE" writes the
+ * same data in the folded-stack format used by flamegraph tools.
+ *
+ * "--cache-dir=DIR" keeps compiled programs in DIR (see ProgramCache).
+ * When the VM engine runs an unchanged script again, it loads the
+ * compiled code from there and skips lexing, parsing and compiling.
+ *
+ * "--emit-c=FILE" translates the program into a standalone C file
+ * instead of running it (see CEmitter). "--native=FILE" also compiles
+ * that C (written to FILE.c) with the system C compiler into the
+ * executable FILE.
+ *
+ * "--specialize=FILE" runs every part of the program that does not
+ * depend on inputInt() and writes the rest to FILE as a new MidLang
+ * program, which prints the same for every input (see Specializer).
+ *
+ * "--watch" runs the program, then runs it again every time the file
+ * changes, re-parsing only the statements that were edited (see
+ * IncrementalProgram). It uses the tree-walking Evaluator and stops when
+ * the file is removed.
+ *
+ * "--batch=FILE" runs the program once for every row of a CSV file of
+ * inputInt() values and writes one CSV row of printed values per input
+ * row (see BatchEvaluator). Only the CSV goes to stdout, so it implies
+ * "--quiet".
+ */
+
+// Exit codes, one per kind of failure, so scripts can tell them apart
+enum ExitCode {
+    EXIT_OK = 0,
+    EXIT_USAGE = 1,      // Bad command line
+    EXIT_IO = 2,         // Source file cannot be read
+    EXIT_LEX = 3,        // LexError
+    EXIT_PARSE = 4,      // ParseError (including undefined variables)
+    EXIT_RUNTIME = 5     // RuntimeError, or any other failure while running
+};
+
+// Engines that can run a program, picked with --engine=
+enum Engine {
+    ENGINE_VM,           // Bytecode on the stack VM (the default)
+    ENGINE_TREE,         // Tree-walking Evaluator
+    ENGINE_JIT,          // Native code, where supported
+    ENGINE_CLOSURE       // Pre-specialized closures
+};
+
+/**
+ * Writes whichever profile reports were asked for. Returns false (after
+ * printing an error) if a report file cannot be written.
+ */
+static bool writeProfile(const Profile& profile, const ProgramNode& program, const std::string& sourceFile,
+                         const std::string& jsonFile, const std::string& foldedFile) {
+    bool ok = true;
+    if (!jsonFile.empty()) {
+        std::ofstream out(jsonFile);
+        profile.writeJson(out, program, sourceFile);
+        if (!out) {
+            std::cerr << "Error: Cannot write profile: " << jsonFile << std::endl;
+            ok = false;
+        }
+    }
+    if (!foldedFile.empty()) {
+        std::ofstream out(foldedFile);
+        profile.writeFolded(out, program);
+        if (!out) {
+            std::cerr << "Error: Cannot write profile: " << foldedFile << std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+/**
+ * Reads a whole file into text. Returns false if it cannot be read.
+ */
+static bool readFile(const std::string& path, std::string& text) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    std::ostringstream contents;
+    contents << in.rdbuf();
+    text = contents.str();
+    return true;
+}
+
+/**
+ * Runs a program, then runs it again after every change to its file
+ * (--watch). Returns once the file is removed.
  */
+static int watchFile(const std::string& sourceFile, bool verbose) {
+    namespace fs = std::filesystem;
+    OutputSink output(std::cout, isInteractive(1));
+    InputSource input;
+    input.tie(&output);
+
+    // Stat before reading, so a write in between is seen as a change
+    std::error_code error;
+    fs::file_time_type lastWrite = fs::last_write_time(sourceFile, error);
+    std::string text;
+    if (!readFile(sourceFile, text)) {
+        std::cerr << "Error: File not found: " << sourceFile << std::endl;
+        return EXIT_IO;
+    }
+    if (verbose) {
+        std::cout << "=== Watching: " << sourceFile << " (Ctrl-C to stop) ===" << std::endl;
+    }
+
+    IncrementalProgram program;
+    for (;;) {
+        try {
+            auto start = std::chrono::steady_clock::now();
+            IncrementalProgram::EditStats stats = program.update(text);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (verbose) {
+                std::cout << std::endl << "Re-parsed " << stats.statements << " statement(s), " << stats.bytes
+                          << " byte(s) in " << ms << " ms" << std::endl;
+                std::cout << "Output:" << std::endl;
+            }
+            Evaluator evaluator(output, input);
+            evaluator.evaluate(&program.current());
+            output.flush();
+        } catch (const std::exception& ex) {
+            output.flush();
+            std::cerr << "Error: " << ex.what() << std::endl;
+        }
+
+        // Poll until the file changes (or is gone)
+        for (;;) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            fs::file_time_type write = fs::last_write_time(sourceFile, error);
+            if (error) {
+                if (verbose) {
+                    std::cout << "=== " << sourceFile << " was removed; stopped watching ===" << std::endl;
+                }
+                return EXIT_OK;
+            }
+            if (write == lastWrite) {
+                continue;
+            }
+            lastWrite = write;
+            std::string changed;
+            if (readFile(sourceFile, changed) && changed != text) {
+                text = std::move(changed);
+                break;
+            }
+        }
+    }
+}
+
+static const char* tokenTypeName(TokenType type) {
+    switch (type) {
+        case TokenType::INTEGER: return "INTEGER";
+        case TokenType::IDENTIFIER: return "IDENTIFIER";
+        case TokenType::PLUS: return "PLUS";
+        case TokenType::MINUS: return "MINUS";
+        case TokenType::MULTIPLY: return "MULTIPLY";
+        case TokenType::DIVIDE: return "DIVIDE";
+        case TokenType::ASSIGN: return "ASSIGN";
+        case TokenType::SEMICOLON: return "SEMICOLON";
+        case TokenType::LEFT_PAREN: return "LEFT_PAREN";
+        case TokenType::RIGHT_PAREN: return "RIGHT_PAREN";
+        case TokenType::VAR: return "VAR";
+        case TokenType::PRINT: return "PRINT";
+        case TokenType::INPUT_INT: return "INPUT_INT";
+        default: return "UNKNOWN";
+    }
+}
+
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        std::cout << "Usage: interpreter <source_file.mid>" << std::endl;
+    std::string sourceFile;
+    Engine engine = ENGINE_VM;
+    bool streaming = false;
+    bool optimize = true;
+    bool ssa = true;
+    bool verbose = true;
+    bool showTimings = false;
+    bool warnings = false;
+    std::string profileFile;
+    std::string foldedProfileFile;
+    std::string cacheDirectory;
+    std::string batchFile;
+    std::string cFile;
+    std::string nativeFile;
+    std::string residualFile;
+    bool watching = false;
+    unsigned threads = 1;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--engine=tree") {
+            engine = ENGINE_TREE;
+        } else if (arg == "--engine=vm") {
+            engine = ENGINE_VM;
+        } else if (arg == "--engine=jit") {
+            engine = ENGINE_JIT;
+        } else if (arg == "--engine=closure") {
+            engine = ENGINE_CLOSURE;
+        } else if (arg == "--no-optimize") {
+            optimize = false;
+        } else if (arg == "--no-ssa") {
+            ssa = false;
+        } else if (arg == "--stream") {
+            streaming = true;
+        } else if (arg == "--quiet") {
+            verbose = false;
+        } else if (arg == "--verbose") {
+            verbose = true;
+        } else if (arg == "--watch") {
+            watching = true;
+        } else if (arg == "--timings") {
+            showTimings = true;
+        } else if (arg == "--warnings") {
+            warnings = true;
+        } else if (arg.rfind("--profile=", 0) == 0 && arg.size() > 10) {
+            profileFile = arg.substr(10);
+        } else if (arg.rfind("--profile-folded=", 0) == 0 && arg.size() > 17) {
+            foldedProfileFile = arg.substr(17);
+        } else if (arg.rfind("--cache-dir=", 0) == 0 && arg.size() > 12) {
+            cacheDirectory = arg.substr(12);
+        } else if (arg.rfind("--batch=", 0) == 0 && arg.size() > 8) {
+            batchFile = arg.substr(8);
+        } else if (arg.rfind("--emit-c=", 0) == 0 && arg.size() > 9) {
+            cFile = arg.substr(9);
+        } else if (arg.rfind("--native=", 0) == 0 && arg.size() > 9) {
+            nativeFile = arg.substr(9);
+        } else if (arg.rfind("--specialize=", 0) == 0 && arg.size() > 13) {
+            residualFile = arg.substr(13);
+        } else if (arg.rfind("--threads=", 0) == 0 && arg.size() > 10 && arg.size() <= 14
+                   && arg.find_first_not_of("0123456789", 10) == std::string::npos) {
+            threads = static_cast<unsigned>(std::stoul(arg.substr(10)));
+        } else if (arg.rfind("--", 0) == 0 || !sourceFile.empty()) {
+            std::cerr << "Error: Unknown argument: " << arg << std::endl;
+            return EXIT_USAGE;
+        } else {
+            sourceFile = arg;
+        }
+    }
+
+    if (sourceFile.empty()) {
+        std::cout << "Usage: interpreter [--quiet|--verbose] [--timings] [--engine=vm|tree|jit|closure] [--no-optimize]"
+                  << " [--no-ssa] [--warnings] [--threads=N]"
+                  << " [--stream] [--profile=FILE] [--profile-folded=FILE] [--cache-dir=DIR]"
+                  << " [--batch=FILE] [--emit-c=FILE] [--native=FILE] [--specialize=FILE] [--watch]"
+                  << " <source_file.mid>" << std::endl;
         std::cout << "Example: interpreter examples/program.mid" << std::endl;
-        return 1;
+        return EXIT_USAGE;
     }
 
-    std::string sourceFile = argv[1];
+    bool profiling = !profileFile.empty() || !foldedProfileFile.empty();
+    if (threads != 1 && (streaming || watching)) {
+        std::cerr << "Error: --threads cannot be combined with --stream or --watch" << std::endl;
+        return EXIT_USAGE;
+    }
+    if (profiling && streaming) {
+        std::cerr << "Error: --profile cannot be combined with --stream" << std::endl;
+        return EXIT_USAGE;
+    }
+    bool batch = !batchFile.empty();
+    if (batch && (streaming || profiling)) {
+        std::cerr << "Error: --batch cannot be combined with --stream or --profile" << std::endl;
+        return EXIT_USAGE;
+    }
+    if (batch) {
+        verbose = false;
+    }
+    if (!nativeFile.empty() && cFile.empty()) {
+        cFile = nativeFile + ".c";
+    }
+    bool emitting = !cFile.empty();
+    if (emitting && (streaming || profiling || batch)) {
+        std::cerr << "Error: --emit-c and --native cannot be combined with --stream, --profile or --batch"
+                  << std::endl;
+        return EXIT_USAGE;
+    }
+    bool specializing = !residualFile.empty();
+    if (specializing && (streaming || profiling || batch || emitting)) {
+        std::cerr << "Error: --specialize cannot be combined with --stream, --profile, --batch or --emit-c"
+                  << std::endl;
+        return EXIT_USAGE;
+    }
 
-    std::ifstream file(sourceFile);
-    if (!file.is_open()) {
+    if (watching) {
+        if (streaming || profiling || batch || emitting || specializing) {
+            std::cerr << "Error: --watch cannot be combined with --stream, --profile, --batch, --emit-c or --specialize"
+                      << std::endl;
+            return EXIT_USAGE;
+        }
+        return watchFile(sourceFile, verbose);
+    }
+
+    PhaseTimings timings;
+    auto finish = [&](int code) {
+        timings.stop();
+        if (showTimings) {
+            timings.report(std::cerr);
+        }
+        return code;
+    };
+
+    // Map the source code (no copies are made of it from here on)
+    timings.start("read");
+    SourceFile file;
+    if (!file.open(sourceFile)) {
         std::cerr << "Error: File not found: " << sourceFile << std::endl;
-        return 1;
+        return finish(EXIT_IO);
     }
+    std::string_view sourceCode = file.text();
 
     try {
-        // Read source code
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        std::string sourceCode = buffer.str();
-        file.close();
+        // Program output is buffered; it is flushed after every value only
+        // when someone is watching a terminal. The sink is flushed when it
+        // goes out of scope, so output always precedes any error message.
+        OutputSink output(std::cout, isInteractive(1));
+        InputSource input;
+        input.tie(&output);
+
+        if (streaming) {
+            if (verbose) {
+                std::cout << "=== Interpreting (streaming): " << sourceFile << " ===" << std::endl;
+                std::cout << "Output:" << std::endl;
+            }
+            timings.start("stream");
+            StreamingInterpreter interpreter(file, output, input);
+            size_t count = interpreter.run();
+            output.flush();
+            timings.stop();
+            if (verbose) {
+                std::cout << std::endl;
+                std::cout << "Executed " << count << " statement(s)" << std::endl;
+                std::cout << "=== Program completed successfully ===" << std::endl;
+            }
+            return finish(EXIT_OK);
+        }
 
-        std::cout << "=== Interpreting: " << sourceFile << " ===" << std::endl << std::endl;
+        if (verbose) {
+            std::cout << "=== Interpreting: " << sourceFile << " ===" << std::endl << std::endl;
+        }
+
+        // The profile reports the statements as written, so they are left alone
+        ssa = ssa && optimize && !profiling;
+        uint32_t passes = (optimize ? ProgramCache::OPTIMIZED : 0) | (ssa ? ProgramCache::SSA : 0);
+
+        // Only bytecode is cached, so the cache serves the VM engine alone
+        ProgramCache cache(cacheDirectory);
+        bool useCache = !cacheDirectory.empty() && engine == ENGINE_VM && !profiling && !batch
+                        && !specializing;
+        if (useCache) {
+            timings.start("cache");
+            CachedProgram cached;
+            if (cache.load(sourceCode, passes, cached)) {
+                if (verbose) {
+                    std::cout << "Loaded compiled program from cache" << std::endl << std::endl;
+                    std::cout << "Stage 3: Evaluation (Execution)" << std::endl;
+                    std::cout << "Output:" << std::endl;
+                }
+                timings.start("evaluate");
+                VM vm(output, input);
+                vm.run(cached.instructions(), cached.slotCount(), cached.maxStackDepth());
+                output.flush();
+                timings.stop();
+                if (verbose) {
+                    std::cout << std::endl;
+                    std::cout << "=== Program completed successfully ===" << std::endl;
+                }
+                return finish(EXIT_OK);
+            }
+            timings.stop();
+        }
 
         // Stage 1: Lexical Analysis
-        std::cout << "Stage 1: Lexical Analysis (Tokenization)" << std::endl;
-        Lexer lexer(sourceCode);
-        auto tokens = lexer.tokenize();
-        std::cout << "Generated " << tokens.size() << " tokens:" << std::endl;
-        for (const auto& token : tokens) {
-            if (token.type != TokenType::EOF_TOKEN) {
-                // Convert token type to string for readability
-                std::string typeStr;
-                switch (token.type) {
-                    case TokenType::INTEGER: typeStr = "INTEGER"; break;
-                    case TokenType::IDENTIFIER: typeStr = "IDENTIFIER"; break;
-                    case TokenType::PLUS: typeStr = "PLUS"; break;
-                    case TokenType::MINUS: typeStr = "MINUS"; break;
-                    case TokenType::MULTIPLY: typeStr = "MULTIPLY"; break;
-                    case TokenType::DIVIDE: typeStr = "DIVIDE"; break;
-                    case TokenType::ASSIGN: typeStr = "ASSIGN"; break;
-                    case TokenType::SEMICOLON: typeStr = "SEMICOLON"; break;
-                    case TokenType::LEFT_PAREN: typeStr = "LEFT_PAREN"; break;
-                    case TokenType::RIGHT_PAREN: typeStr = "RIGHT_PAREN"; break;
-                    case TokenType::VAR: typeStr = "VAR"; break;
-                    case TokenType::PRINT: typeStr = "PRINT"; break;
-                    case TokenType::INPUT_INT: typeStr = "INPUT_INT"; break;
-                    default: typeStr = "UNKNOWN"; break;
+        if (verbose) {
+            std::cout << "Stage 1: Lexical Analysis (Tokenization)" << std::endl;
+        }
+        std::unique_ptr<ProgramNode> ast;
+        if (threads != 1) {
+            // Both stages at once, one chunk of the source per thread
+            timings.start("lex+parse");
+            ParallelFrontEnd frontEnd(threads);
+            ast = frontEnd.parse(sourceCode);
+            timings.stop();
+            if (verbose) {
+                std::cout << "Generated " << frontEnd.tokenCount() << " tokens in " << frontEnd.chunkCount()
+                          << " chunk(s) on " << frontEnd.threadCount() << " thread(s)" << std::endl;
+                std::cout << std::endl;
+                std::cout << "Stage 2: Parsing (Building AST)" << std::endl;
+            }
+        } else {
+            timings.start("lex");
+            Lexer lexer(sourceCode);
+            auto tokens = lexer.tokenize();
+            timings.stop();
+            if (verbose) {
+                std::cout << "Generated " << tokens.size() << " tokens:" << std::endl;
+                for (size_t i = 0; i < tokens.size(); i++) {
+                    if (tokens.types[i] != TokenType::EOF_TOKEN) {
+                        // '\n' rather than std::endl: one flush for the whole dump
+                        std::cout << "  " << tokenTypeName(tokens.types[i]) << "(" << tokens.text(i) << ")\n";
+                    }
                 }
-                std::cout << "  " << typeStr << "(" << token.value << ")" << std::endl;
+                std::cout << std::endl;
             }
+
+            // Stage 2: Parsing
+            if (verbose) {
+                std::cout << "Stage 2: Parsing (Building AST)" << std::endl;
+            }
+            timings.start("parse");
+            Parser parser(tokens);
+            ast = parser.parse();
+            timings.stop();
+        }
+        if (verbose) {
+            std::cout << "Parsed " << ast->statements.size() << " statement(s)" << std::endl;
+        }
+        timings.start("resolve");
+        Resolver resolver;
+        resolver.resolve(ast.get());
+        timings.stop();
+        if (verbose) {
+            std::cout << "Resolved " << ast->slotNames.size() << " variable(s)" << std::endl;
         }
-        std::cout << std::endl;
 
-        // Stage 2: Parsing
-        std::cout << "Stage 2: Parsing (Building AST)" << std::endl;
-        Parser parser(tokens);
-        auto ast = parser.parse();
-        std::cout << "Parsed " << ast->statements.size() << " statement(s)" << std::endl;
-        std::cout << std::endl;
+        // Partial evaluation instead of running the program. It reads the
+        // program as written, so the result keeps its variable names
+        if (specializing) {
+            timings.start("specialize");
+            std::ofstream residualOutput(residualFile);
+            Specializer specializer;
+            Specializer::Stats stats = specializer.specialize(*ast, residualOutput);
+            residualOutput.close();
+            timings.stop();
+            if (!residualOutput) {
+                std::cerr << "Error: Cannot write residual program: " << residualFile << std::endl;
+                return finish(EXIT_IO);
+            }
+            if (verbose) {
+                std::cout << "Specialized: " << stats.residualStatements << " of " << stats.statements
+                          << " statement(s) left to run, " << stats.knownPrints << " print(s) of known values"
+                          << std::endl << std::endl;
+                std::cout << "Wrote residual program to " << residualFile << std::endl;
+            }
+            return finish(EXIT_OK);
+        }
+        // Only the engines that read the AST skip proven checks; the VM,
+        // the batch evaluator and the C emitter keep every check
+        bool skipsChecks = engine != ENGINE_VM && !batch && !emitting;
+        if (warnings || skipsChecks) {
+            timings.start("analyze");
+            RangeAnalysis ranges;
+            RangeAnalysis::Stats rangeStats = ranges.analyze(ast.get());
+            timings.stop();
+            if (verbose) {
+                std::cout << "Range analysis: " << rangeStats.provenDivisions << " of " << rangeStats.divisions
+                          << " division(s) need no check, " << ranges.diagnostics().size() << " warning(s)"
+                          << std::endl;
+            }
+            if (warnings) {
+                for (const RangeAnalysis::Diagnostic& diagnostic : ranges.diagnostics()) {
+                    std::cerr << "Warning: " << RangeAnalysis::message(diagnostic) << std::endl;
+                }
+            }
+        }
+        if (optimize) {
+            timings.start("optimize");
+            Optimizer optimizer;
+            size_t removed = optimizer.optimize(ast.get());
+            timings.stop();
+            if (verbose) {
+                std::cout << "Optimized: removed " << removed << " node(s)" << std::endl;
+            }
+        }
+        if (ssa) {
+            timings.start("ssa");
+            SsaOptimizer ssaOptimizer;
+            SsaOptimizer::Stats stats = ssaOptimizer.optimize(ast.get());
+            timings.stop();
+            if (verbose) {
+                std::cout << "SSA: removed " << stats.statementsRemoved << " dead store(s), reused "
+                          << stats.expressionsReused << " expression(s) via " << stats.temporaries
+                          << " temporary(ies), removed " << stats.nodesRemoved << " node(s)" << std::endl;
+            }
+        }
+        if (verbose) {
+            std::cout << std::endl;
+        }
+
+        // Ahead-of-time compilation instead of running the program
+        if (emitting) {
+            timings.start("emit C");
+            std::ofstream cOutput(cFile);
+            CEmitter emitter;
+            emitter.emit(*ast, cOutput);
+            cOutput.close();
+            if (!cOutput) {
+                std::cerr << "Error: Cannot write C file: " << cFile << std::endl;
+                return finish(EXIT_IO);
+            }
+            if (verbose) {
+                std::cout << "Wrote C source to " << cFile << std::endl;
+            }
+            if (!nativeFile.empty()) {
+                timings.start("cc");
+                std::string command;
+                if (!CEmitter::buildExecutable(cFile, nativeFile, command)) {
+                    std::cerr << "Error: C compiler failed: " << command << std::endl;
+                    return finish(EXIT_RUNTIME);
+                }
+                if (verbose) {
+                    std::cout << "Built native executable " << nativeFile << std::endl;
+                }
+            }
+            return finish(EXIT_OK);
+        }
 
         // Stage 3: Evaluation
-        std::cout << "Stage 3: Evaluation (Execution)" << std::endl;
-        std::cout << "Output:" << std::endl;
-        Evaluator evaluator;
-        evaluator.evaluate(ast.get());
-        std::cout << std::endl;
+        if (verbose) {
+            std::cout << "Stage 3: Evaluation (Execution)" << std::endl;
+            std::cout << "Output:" << std::endl;
+        }
+        bool profileWritten = true;
+        if (batch) {
+            timings.start("read batch");
+            SourceFile rows;
+            if (!rows.open(batchFile)) {
+                std::cerr << "Error: File not found: " << batchFile << std::endl;
+                return finish(EXIT_IO);
+            }
+            timings.start("evaluate");
+            BatchEvaluator evaluator(*ast);
+            BatchEvaluator::Summary summary = evaluator.run(rows.text(), std::cout);
+            timings.stop();
+            std::cerr << "Batch: " << summary.rows << " row(s), " << summary.failedRows << " failed ("
+                      << selectKernels().name << " kernels)" << std::endl;
+        } else if (profiling) {
+            // Profiling is built into the tree-walking Evaluator
+            timings.start("evaluate");
+            Evaluator evaluator(output, input);
+            Profile profile;
+            try {
+                evaluator.evaluate(ast.get(), profile);
+            } catch (...) {
+                writeProfile(profile, *ast, sourceFile, profileFile, foldedProfileFile);
+                throw;
+            }
+            profileWritten = writeProfile(profile, *ast, sourceFile, profileFile, foldedProfileFile);
+        } else if (engine == ENGINE_JIT && JIT::canRun(*ast)) {
+            timings.start("compile");
+            JIT jit(output, input);
+            jit.compile(*ast);
+            timings.start("evaluate");
+            jit.run();
+        } else if (engine == ENGINE_CLOSURE && ClosureEngine::canRun(*ast)) {
+            timings.start("compile");
+            ClosureEngine closures(output, input);
+            closures.compile(*ast);
+            timings.start("evaluate");
+            closures.run();
+        } else if (engine != ENGINE_VM) {
+            if (engine == ENGINE_JIT && !JIT::isSupported() && verbose) {
+                std::cout << "(no JIT on this platform; using the tree-walking evaluator)" << std::endl;
+            } else if (engine != ENGINE_TREE && verbose) {
+                std::cout << "(expressions nested too deeply for this engine; using the tree-walking evaluator)"
+                          << std::endl;
+            }
+            timings.start("evaluate");
+            Evaluator evaluator(output, input);
+            evaluator.evaluate(ast.get());
+        } else {
+            timings.start("compile");
+            Compiler compiler;
+            BytecodeProgram program = compiler.compile(ast.get());
+            if (useCache) {
+                timings.start("cache");
+            }
+            if (useCache && !cache.store(sourceCode, passes, program)) {
+                std::cerr << "Warning: Cannot write to cache directory: " << cacheDirectory << std::endl;
+            }
+            timings.start("evaluate");
+            VM vm(output, input);
+            vm.run(program);
+        }
+        output.flush();
+        timings.stop();
 
-        std::cout << "=== Program completed successfully ===" << std::endl;
+        if (verbose) {
+            std::cout << std::endl;
+            std::cout << "=== Program completed successfully ===" << std::endl;
+        }
+        if (!profileWritten) {
+            return finish(EXIT_IO);
+        }
+    } catch (const LexError& ex) {
+        std::cerr << "Error: " << ex.what() << std::endl;
+        return finish(EXIT_LEX);
+    } catch (const ParseError& ex) {
+        std::cerr << "Error: " << ex.what() << std::endl;
+        return finish(EXIT_PARSE);
     } catch (const std::exception& ex) {
         std::cerr << "Error: " << ex.what() << std::endl;
-        return 1;
+        return finish(EXIT_RUNTIME);
     }
 
-    return 0;
+    return finish(EXIT_OK);
 }
-